@@ -26,26 +26,56 @@
 
 #include "triton/tensorflow_backend_tf.h"
 
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
 #include "tensorflow/c/c_api.h"
+#include "tensorflow/cc/saved_model/constants.h"
 #include "tensorflow/cc/saved_model/loader.h"
+#include "tensorflow/cc/saved_model/loader_util.h"
+#include "tensorflow/cc/saved_model/reader.h"
 #include "tensorflow/cc/saved_model/tag_constants.h"
+#include "tensorflow/cc/tools/freeze_saved_model.h"
 #include "tensorflow/core/common_runtime/device.h"
 #include "tensorflow/core/common_runtime/device_mgr.h"
 #include "tensorflow/core/common_runtime/gpu/gpu_id_utils.h"
 #include "tensorflow/core/common_runtime/gpu/gpu_mem_allocator.h"
 #include "tensorflow/core/common_runtime/gpu/gpu_process_state.h"
+#include "tensorflow/core/common_runtime/process_state.h"
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/step_stats.pb.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_util.h"
 #include "tensorflow/core/framework/tensor_shape.pb.h"
 #include "tensorflow/core/framework/types.pb.h"
 #include "tensorflow/core/graph/default_device.h"
 #include "tensorflow/core/grappler/utils.h"
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/hash/hash.h"
+#include "tensorflow/core/lib/monitoring/collection_registry.h"
+#include "tensorflow/core/lib/strings/proto_serialization.h"
+#include "tensorflow/core/platform/blocking_counter.h"
 #include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/platform/threadpool.h"
+#include "tensorflow/core/platform/threadpool_options.h"
 #include "tensorflow/core/protobuf/meta_graph.pb.h"
 #include "tensorflow/core/protobuf/rewriter_config.pb.h"
 #include "tensorflow/core/public/session.h"
 #include "tensorflow/core/public/session_options.h"
 #include "tensorflow/core/util/device_name_utils.h"
+#include "tensorflow/core/util/util.h"
 #include "third_party/gpus/cuda/include/cuda_runtime_api.h"
 
 TRITONTF_Error* TRITONTF_ErrorNew(const std::string& str);
@@ -56,12 +86,16 @@ TRITONTF_IOList* TRITONTF_IOListNew(
 void TRITONTF_IOListDelete(TRITONTF_IOList* list);
 
 // If TensorFlow status is non-OK, return the equivalent TRITONTF_Error
-#define RETURN_IF_TF_ERROR(TFS)                           \
-  do {                                                    \
-    const tensorflow::Status& status__ = (TFS);           \
-    if (status__.code() != 0) {                           \
-      return TRITONTF_ErrorNew(status__.error_message()); \
-    }                                                     \
+#define RETURN_IF_TF_ERROR(TFS)                                      \
+  do {                                                               \
+    const tensorflow::Status& status__ = (TFS);                      \
+    if (status__.code() != 0) {                                      \
+      TRITONTF_Error* error__ =                                      \
+          TRITONTF_ErrorNew(status__.error_message());               \
+      error__->timed_out_ =                                          \
+          (status__.code() == tensorflow::error::DEADLINE_EXCEEDED); \
+      return error__;                                                \
+    }                                                                \
   } while (false)
 
 namespace {
@@ -98,6 +132,8 @@ ConvertDataType(tensorflow::DataType dtype)
       return TRITONTF_DataType::TRITONTF_TYPE_FP64;
     case tensorflow::DT_STRING:
       return TRITONTF_DataType::TRITONTF_TYPE_STRING;
+    case tensorflow::DT_BFLOAT16:
+      return TRITONTF_DataType::TRITONTF_TYPE_BF16;
     default:
       break;
   }
@@ -137,6 +173,8 @@ ConvertDataType(TRITONTF_DataType dtype)
       return tensorflow::DT_DOUBLE;
     case TRITONTF_DataType::TRITONTF_TYPE_STRING:
       return tensorflow::DT_STRING;
+    case TRITONTF_DataType::TRITONTF_TYPE_BF16:
+      return tensorflow::DT_BFLOAT16;
     default:
       break;
   }
@@ -216,6 +254,8 @@ NewSessionOptions(
     const bool allow_soft_placement,
     const std::map<int, std::vector<float>>& memory_limit_mb,
     const TRITONTF_TFTRTConfig* tftrt_config, const bool auto_mixed_precision,
+    const bool cpu_auto_mixed_precision,
+    const TRITONTF_GrapplerConfig* grappler_config,
     tensorflow::SessionOptions* session_options)
 {
   session_options->config.set_intra_op_parallelism_threads(num_intra_threads);
@@ -303,6 +343,60 @@ NewSessionOptions(
     opt_config->set_meta_optimizer_iterations(tensorflow::RewriterConfig::ONE);
     opt_config->set_auto_mixed_precision(tensorflow::RewriterConfig::ON);
   }
+
+  // Rewrite the CPU part of the graph to bfloat16 so that it can use
+  // the AMX / AVX512-BF16 kernels of oneDNN.
+  if (cpu_auto_mixed_precision) {
+    auto opt_config = session_options->config.mutable_graph_options()
+                          ->mutable_rewrite_options();
+    opt_config->set_meta_optimizer_iterations(tensorflow::RewriterConfig::ONE);
+    opt_config->set_auto_mixed_precision_onednn_bfloat16(
+        tensorflow::RewriterConfig::ON);
+  }
+
+  // Individual grappler rewriters, applied last so that an explicit
+  // setting overrides the ones implied by the optimizations above.
+  if (grappler_config != nullptr) {
+    auto opt_config = session_options->config.mutable_graph_options()
+                          ->mutable_rewrite_options();
+    const std::vector<std::pair<
+        TRITONTF_Toggle, void (tensorflow::RewriterConfig::*)(
+                             tensorflow::RewriterConfig::Toggle)>>
+        toggles{
+            {grappler_config->remapping_,
+             &tensorflow::RewriterConfig::set_remapping},
+            {grappler_config->arithmetic_optimization_,
+             &tensorflow::RewriterConfig::set_arithmetic_optimization},
+            {grappler_config->dependency_optimization_,
+             &tensorflow::RewriterConfig::set_dependency_optimization},
+            {grappler_config->loop_optimization_,
+             &tensorflow::RewriterConfig::set_loop_optimization}};
+    for (const auto& toggle : toggles) {
+      if (toggle.first != TRITONTF_TOGGLE_DEFAULT) {
+        (opt_config->*toggle.second)(
+            (toggle.first == TRITONTF_TOGGLE_ON)
+                ? tensorflow::RewriterConfig::ON
+                : tensorflow::RewriterConfig::OFF);
+      }
+    }
+    if (grappler_config->memory_optimization_ != TRITONTF_TOGGLE_DEFAULT) {
+      opt_config->set_memory_optimization(
+          (grappler_config->memory_optimization_ == TRITONTF_TOGGLE_ON)
+              ? tensorflow::RewriterConfig::HEURISTICS
+              : tensorflow::RewriterConfig::NO_MEM_OPT);
+    }
+    if (grappler_config->model_pruning_ != TRITONTF_TOGGLE_DEFAULT) {
+      opt_config->set_disable_model_pruning(
+          grappler_config->model_pruning_ == TRITONTF_TOGGLE_OFF);
+    }
+    if (grappler_config->meta_optimizer_iterations_ == 1) {
+      opt_config->set_meta_optimizer_iterations(
+          tensorflow::RewriterConfig::ONE);
+    } else if (grappler_config->meta_optimizer_iterations_ == 2) {
+      opt_config->set_meta_optimizer_iterations(
+          tensorflow::RewriterConfig::TWO);
+    }
+  }
 }
 
 // Get the device name in model session given a non-negative device_id.
@@ -330,6 +424,172 @@ GetTFGPUDeviceName(
   return nullptr;
 }
 
+// Prune 'graph_def' to the nodes named in 'keep_nodes' and the nodes
+// that they depend on through data or control edges. 'keep_nodes' may
+// name tensors ("node:1") or control inputs ("^node").
+void
+PruneGraphDef(
+    const char** keep_nodes, const size_t keep_node_count,
+    tensorflow::GraphDef* graph_def)
+{
+  std::unordered_map<std::string, int> node_index;
+  for (int i = 0; i < graph_def->node_size(); ++i) {
+    node_index.emplace(graph_def->node(i).name(), i);
+  }
+
+  std::vector<bool> keep(graph_def->node_size(), false);
+  std::vector<int> queue;
+  const auto visit = [&](const std::string& name) {
+    auto it = node_index.find(tensorflow::grappler::NodeName(name));
+    if ((it != node_index.end()) && !keep[it->second]) {
+      keep[it->second] = true;
+      queue.push_back(it->second);
+    }
+  };
+  for (size_t i = 0; i < keep_node_count; ++i) {
+    visit(keep_nodes[i]);
+  }
+  while (!queue.empty()) {
+    const int idx = queue.back();
+    queue.pop_back();
+    for (const auto& input : graph_def->node(idx).input()) {
+      visit(input);
+    }
+  }
+
+  tensorflow::GraphDef pruned;
+  *pruned.mutable_versions() = graph_def->versions();
+  *pruned.mutable_library() = graph_def->library();
+  for (int i = 0; i < graph_def->node_size(); ++i) {
+    if (keep[i]) {
+      pruned.add_node()->Swap(graph_def->mutable_node(i));
+    }
+  }
+  graph_def->Swap(&pruned);
+}
+
+// Replace the session of 'bundle' with a session of the frozen
+// graph of the bundle, in which the variables restored in the current
+// session are constants. The frozen graph has no init op, so only
+// models whose init op does no work can be frozen.
+TRITONTF_Error*
+FreezeSavedModelSession(
+    const char* model_name, const int device_id,
+    const tensorflow::SessionOptions& session_options,
+    tensorflow::SavedModelBundle* bundle)
+{
+  const tensorflow::MetaGraphDef& meta_graph_def = bundle->meta_graph_def;
+  std::vector<std::string> init_ops;
+  auto init_sig_itr =
+      meta_graph_def.signature_def().find("__saved_model_init_op");
+  if (init_sig_itr != meta_graph_def.signature_def().end()) {
+    for (const auto& out : init_sig_itr->second.outputs()) {
+      init_ops.push_back(out.second.name());
+    }
+  }
+  for (const char* key : {"saved_model_main_op", "legacy_init_op"}) {
+    auto col_itr = meta_graph_def.collection_def().find(key);
+    if (col_itr != meta_graph_def.collection_def().end()) {
+      for (const auto& name : col_itr->second.node_list().value()) {
+        init_ops.push_back(name);
+      }
+    }
+  }
+  if (!init_ops.empty()) {
+    std::vector<const char*> init_op_names;
+    for (const auto& name : init_ops) {
+      init_op_names.push_back(name.c_str());
+    }
+    tensorflow::GraphDef init_graph_def = meta_graph_def.graph_def();
+    PruneGraphDef(init_op_names.data(), init_op_names.size(), &init_graph_def);
+    for (const auto& node : init_graph_def.node()) {
+      if (node.op() != "NoOp") {
+        return TRITONTF_ErrorNew(
+            "unable to freeze variables of model '" + std::string(model_name) +
+            "', the init op of the model runs '" + node.name() + "' (" +
+            node.op() + ")");
+      }
+    }
+  }
+
+  tensorflow::GraphDef frozen_graph_def;
+  std::unordered_set<std::string> frozen_inputs, frozen_outputs;
+  RETURN_IF_TF_ERROR(tensorflow::FreezeSavedModel(
+      *bundle, &frozen_graph_def, &frozen_inputs, &frozen_outputs));
+
+  if (device_id != TRITONTF_MODEL_DEVICE) {
+    for (tensorflow::NodeDef& node : *frozen_graph_def.mutable_node()) {
+      if (!tensorflow::grappler::NodeIsOnCpu(&node)) {
+        node.clear_device();
+      }
+    }
+    if (device_id == TRITONTF_NO_GPU_DEVICE) {
+      tensorflow::graph::SetDefaultDevice("/cpu:0", &frozen_graph_def);
+    } else {
+      tensorflow::graph::SetDefaultDevice(
+          "/gpu:" + std::to_string(device_id), &frozen_graph_def);
+    }
+  }
+
+  // Grappler optimizes the frozen graph when the new session first
+  // runs it, folding and fusing across the now constant weights.
+  tensorflow::Session* session;
+  RETURN_IF_TF_ERROR(tensorflow::NewSession(session_options, &session));
+  std::unique_ptr<tensorflow::Session> frozen_session(session);
+  RETURN_IF_TF_ERROR(frozen_session->Create(frozen_graph_def));
+
+  bundle->session->Close().IgnoreError();
+  bundle->session = std::move(frozen_session);
+  LOG(INFO) << "froze the variables of model " << model_name;
+  return nullptr;
+}
+
+//
+// Huge pages
+//
+constexpr uintptr_t kHugePageSize = 2 * 1024 * 1024;
+
+std::atomic<bool> huge_pages_enabled{false};
+std::mutex huge_page_mu;
+// The part of each CPU allocator region that is advised to use huge
+// pages, the bytes advised now and the most advised at any time.
+std::map<void*, size_t> huge_page_regions;
+size_t huge_page_bytes = 0;
+size_t huge_page_peak_bytes = 0;
+
+// CPU allocator visitor that advises the huge page aligned part of a
+// new region to be backed by transparent huge pages. The kernel only
+// backs the region with huge pages when it can, so the advised bytes
+// bound the huge page backed bytes from above.
+void
+AdviseHugePages(void* ptr, int numa_node, size_t num_bytes)
+{
+  const uintptr_t begin =
+      (reinterpret_cast<uintptr_t>(ptr) + kHugePageSize - 1) &
+      ~(kHugePageSize - 1);
+  const uintptr_t end =
+      (reinterpret_cast<uintptr_t>(ptr) + num_bytes) & ~(kHugePageSize - 1);
+  if ((end > begin) &&
+      (madvise(reinterpret_cast<void*>(begin), end - begin, MADV_HUGEPAGE) ==
+       0)) {
+    std::lock_guard<std::mutex> lk(huge_page_mu);
+    huge_page_regions[ptr] = end - begin;
+    huge_page_bytes += end - begin;
+    huge_page_peak_bytes = std::max(huge_page_peak_bytes, huge_page_bytes);
+  }
+}
+
+void
+ReleaseHugePages(void* ptr, int numa_node, size_t num_bytes)
+{
+  std::lock_guard<std::mutex> lk(huge_page_mu);
+  auto itr = huge_page_regions.find(ptr);
+  if (itr != huge_page_regions.end()) {
+    huge_page_bytes -= itr->second;
+    huge_page_regions.erase(itr);
+  }
+}
+
 //
 // TensorImpl
 //
@@ -337,7 +597,8 @@ class TensorImpl {
  public:
   TensorImpl(
       const char* name, TRITONTF_DataType dtype, TRITONTF_Shape* shape,
-      const tensorflow::TensorShape& tfshape, const int tf_gpu_id);
+      const tensorflow::TensorShape& tfshape, const int tf_gpu_id,
+      const int numa_node);
   TensorImpl(tensorflow::Tensor&& tftensor);
   ~TensorImpl();
 
@@ -353,6 +614,8 @@ class TensorImpl {
 
   const std::string& String(size_t idx) const;
   void SetString(size_t idx, const std::string& str);
+  void SetStrings(
+      size_t idx, size_t count, const char** strs, const size_t* lengths);
 
  private:
   void Init();
@@ -370,7 +633,8 @@ class TensorImpl {
 
 TensorImpl::TensorImpl(
     const char* name, TRITONTF_DataType dtype, TRITONTF_Shape* shape,
-    const tensorflow::TensorShape& tfshape, const int tf_gpu_id)
+    const tensorflow::TensorShape& tfshape, const int tf_gpu_id,
+    const int numa_node)
     : name_(name), dtype_(dtype), shape_(shape)
 {
   // Only request for GPU allocator for supported data type
@@ -379,6 +643,21 @@ TensorImpl::TensorImpl(
                      tensorflow::GPUOptions(), tensorflow::TfGpuId(tf_gpu_id),
                      1 << 28 /* total_memory_size */)
                : nullptr;
+  // Otherwise bind the CPU tensor to the requested NUMA node, the
+  // per-node allocators only exist once NUMA is enabled.
+  if ((a == nullptr) && (numa_node >= 0)) {
+    static std::once_flag numa_enabled;
+    std::call_once(numa_enabled, []() {
+      tensorflow::ProcessState::singleton()->EnableNUMA();
+    });
+    a = tensorflow::ProcessState::singleton()->GetCPUAllocator(numa_node);
+  }
+  // The default CPU allocator isn't the one that huge pages are
+  // enabled for, use the allocator of the CPU devices instead.
+  if ((a == nullptr) && huge_pages_enabled) {
+    a = tensorflow::ProcessState::singleton()->GetCPUAllocator(
+        tensorflow::port::kNUMANoAffinity);
+  }
   if (a == nullptr) {
     tftensor_ = tensorflow::Tensor(ConvertDataType(dtype), tfshape);
   } else {
@@ -435,6 +714,366 @@ TensorImpl::SetString(size_t idx, const std::string& str)
   flat(idx) = str;
 }
 
+void
+TensorImpl::SetStrings(
+    size_t idx, size_t count, const char** strs, const size_t* lengths)
+{
+  // Assign in place so each string is copied once, directly into the
+  // tensor element.
+  auto flat = tftensor_.flat<std::string>();
+  for (size_t i = 0; i < count; ++i) {
+    flat(idx + i).assign(strs[i], lengths[i]);
+  }
+}
+
+//
+// ThreadPoolsImpl
+//
+class ThreadPoolsImpl {
+ public:
+  ThreadPoolsImpl(
+      const std::string& name, const int num_intra_threads,
+      const int num_inter_threads, const std::vector<int>& cpu_ids,
+      const int numa_node);
+
+  const tensorflow::thread::ThreadPoolOptions& Options() const
+  {
+    return options_;
+  }
+
+ private:
+  // ThreadPoolOptions takes the TF thread pool interface, which the
+  // TF thread pool only exposes as an Eigen thread pool.
+  class PoolAdapter : public tensorflow::thread::ThreadPoolInterface {
+   public:
+    explicit PoolAdapter(tensorflow::thread::ThreadPool* pool)
+        : pool_(pool->AsEigenThreadPool())
+    {
+    }
+    void Schedule(std::function<void()> fn) override
+    {
+      pool_->Schedule(std::move(fn));
+    }
+    void ScheduleWithHint(
+        std::function<void()> fn, int start, int limit) override
+    {
+      pool_->ScheduleWithHint(std::move(fn), start, limit);
+    }
+    void Cancel() override { pool_->Cancel(); }
+    int NumThreads() const override { return pool_->NumThreads(); }
+    int CurrentThreadId() const override { return pool_->CurrentThreadId(); }
+
+   private:
+    Eigen::ThreadPoolInterface* pool_;
+  };
+
+  // Env that pins the threads it starts to a set of CPUs.
+  class AffinityEnv : public tensorflow::EnvWrapper {
+   public:
+    explicit AffinityEnv(const std::vector<int>& cpu_ids)
+        : tensorflow::EnvWrapper(tensorflow::Env::Default())
+    {
+      CPU_ZERO(&cpu_set_);
+      for (const int cpu : cpu_ids) {
+        CPU_SET(cpu, &cpu_set_);
+      }
+    }
+    tensorflow::Thread* StartThread(
+        const tensorflow::ThreadOptions& thread_options,
+        const std::string& name, std::function<void()> fn) override
+    {
+      const cpu_set_t cpu_set = cpu_set_;
+      return target()->StartThread(
+          thread_options, name, [cpu_set, name, fn]() {
+            const int rc = pthread_setaffinity_np(
+                pthread_self(), sizeof(cpu_set), &cpu_set);
+            if (rc != 0) {
+              LOG(WARNING) << "unable to pin thread " << name
+                           << " to its CPUs: " << strerror(rc);
+            }
+            fn();
+          });
+    }
+
+   private:
+    cpu_set_t cpu_set_;
+  };
+
+  std::unique_ptr<AffinityEnv> env_;
+  std::unique_ptr<tensorflow::thread::ThreadPool> intra_pool_;
+  std::unique_ptr<tensorflow::thread::ThreadPool> inter_pool_;
+  std::unique_ptr<PoolAdapter> intra_adapter_;
+  std::unique_ptr<PoolAdapter> inter_adapter_;
+  tensorflow::thread::ThreadPoolOptions options_;
+};
+
+ThreadPoolsImpl::ThreadPoolsImpl(
+    const std::string& name, const int num_intra_threads,
+    const int num_inter_threads, const std::vector<int>& cpu_ids,
+    const int numa_node)
+{
+  tensorflow::Env* env = tensorflow::Env::Default();
+  if (!cpu_ids.empty()) {
+    env_.reset(new AffinityEnv(cpu_ids));
+    env = env_.get();
+  }
+  tensorflow::ThreadOptions thread_options;
+  if (numa_node >= 0) {
+    thread_options.numa_node = numa_node;
+  }
+
+  if (num_intra_threads > 0) {
+    intra_pool_.reset(new tensorflow::thread::ThreadPool(
+        env, thread_options, name + "_intra", num_intra_threads,
+        true /* low_latency_hint */, nullptr /* allocator */));
+    intra_adapter_.reset(new PoolAdapter(intra_pool_.get()));
+    options_.intra_op_threadpool = intra_adapter_.get();
+  }
+  if (num_inter_threads > 0) {
+    inter_pool_.reset(new tensorflow::thread::ThreadPool(
+        env, thread_options, name + "_inter", num_inter_threads,
+        true /* low_latency_hint */, nullptr /* allocator */));
+    inter_adapter_.reset(new PoolAdapter(inter_pool_.get()));
+    options_.inter_op_threadpool = inter_adapter_.get();
+  }
+}
+
+// Collect the inputs and outputs of SignatureDef 'def' into 'inputs'
+// and 'outputs'.
+TRITONTF_Error*
+CollectSignatureIO(
+    const std::string& model_name, const tensorflow::SignatureDef& def,
+    TRITONTF_IOList** inputs, TRITONTF_IOList** outputs)
+{
+  // Collect the inputs...
+  for (const auto& sin : def.inputs()) {
+    *inputs = TRITONTF_IOListNew(
+        sin.first.c_str(), sin.second.name().c_str(), *inputs);
+    TRITONTF_IO* io = (*inputs)->io_;
+
+    const TRITONTF_DataType dt = ConvertDataType(sin.second.dtype());
+    if (dt == TRITONTF_DataType::TRITONTF_TYPE_INVALID) {
+      return TRITONTF_ErrorNew(
+          "unable to process input '" + std::string(io->name_) + "' for '" +
+          std::string(model_name) + "', unsupported datatype '" +
+          tensorflow::DataType_Name(sin.second.dtype()) + "'");
+    }
+
+    io->data_type_ = dt;
+
+    const tensorflow::TensorShapeProto& shape = sin.second.tensor_shape();
+    int64_t shape_dims[shape.dim().size()];
+    for (int i = 0; i < shape.dim().size(); ++i) {
+      shape_dims[i] = shape.dim(i).size();
+    }
+
+    io->shape_ = TRITONTF_ShapeNew(shape.dim().size(), shape_dims);
+  }
+
+  // Collect the outputs...
+  for (const auto& sout : def.outputs()) {
+    *outputs = TRITONTF_IOListNew(
+        sout.first.c_str(), sout.second.name().c_str(), *outputs);
+    TRITONTF_IO* io = (*outputs)->io_;
+
+    const TRITONTF_DataType dt = ConvertDataType(sout.second.dtype());
+    if (dt == TRITONTF_DataType::TRITONTF_TYPE_INVALID) {
+      return TRITONTF_ErrorNew(
+          "unable to process output '" + std::string(io->name_) + "' for '" +
+          std::string(model_name) + "', unsupported datatype '" +
+          tensorflow::DataType_Name(sout.second.dtype()) + "'");
+    }
+
+    io->data_type_ = dt;
+
+    const tensorflow::TensorShapeProto& shape = sout.second.tensor_shape();
+    int64_t shape_dims[shape.dim().size()];
+    for (int i = 0; i < shape.dim().size(); ++i) {
+      shape_dims[i] = shape.dim(i).size();
+    }
+
+    io->shape_ = TRITONTF_ShapeNew(shape.dim().size(), shape_dims);
+  }
+
+  return nullptr;
+}
+
+// Return the peak bytes that a run allocated from the CPU allocators
+// according to its step stats, the sum over the CPU allocators of the
+// largest peak that a node of the run reached in each of them.
+int64_t
+StepCPUBytes(const tensorflow::RunMetadata& meta_data)
+{
+  std::unordered_map<std::string, int64_t> peak_bytes;
+  for (const auto& dev_stats : meta_data.step_stats().dev_stats()) {
+    for (const auto& node_stats : dev_stats.node_stats()) {
+      for (const auto& memory : node_stats.memory()) {
+        std::string allocator_name = memory.allocator_name();
+        std::transform(
+            allocator_name.begin(), allocator_name.end(),
+            allocator_name.begin(), ::tolower);
+        if ((allocator_name.find("cpu") != std::string::npos) ||
+            (allocator_name.find("host") != std::string::npos)) {
+          int64_t& bytes = peak_bytes[allocator_name];
+          bytes = std::max(bytes, memory.peak_bytes());
+        }
+      }
+    }
+  }
+  int64_t bytes = 0;
+  for (const auto& allocator : peak_bytes) {
+    bytes += allocator.second;
+  }
+  return bytes;
+}
+
+// Times the phases of a model creation.
+class LoadPhaseTimer {
+ public:
+  LoadPhaseTimer() : start_(std::chrono::steady_clock::now()) {}
+
+  // Record the time since the previous phase ended as phase 'phase'.
+  void EndPhase(const std::string& phase)
+  {
+    const auto now = std::chrono::steady_clock::now();
+    phases_.emplace_back(
+        phase, std::chrono::duration_cast<std::chrono::microseconds>(
+                   now - start_)
+                   .count());
+    start_ = now;
+  }
+
+  // Record 'usecs' as phase 'phase' without ending the current phase.
+  void AddPhase(const std::string& phase, const uint64_t usecs)
+  {
+    phases_.emplace_back(phase, usecs);
+  }
+
+  std::vector<std::pair<std::string, uint64_t>> Release()
+  {
+    return std::move(phases_);
+  }
+
+ private:
+  std::chrono::steady_clock::time_point start_;
+  std::vector<std::pair<std::string, uint64_t>> phases_;
+};
+
+// Get in 'stage_usecs' the cumulative time, in microseconds, of each
+// stage of the SavedModel loads of 'model_path', as recorded by the
+// loader.
+void
+SavedModelLoadStageUsecs(
+    const std::string& model_path, std::map<std::string, double>* stage_usecs)
+{
+  stage_usecs->clear();
+  tensorflow::monitoring::CollectionRegistry::CollectMetricsOptions options;
+  options.collect_metric_descriptors = false;
+  auto metrics =
+      tensorflow::monitoring::CollectionRegistry::Default()->CollectMetrics(
+          options);
+  auto it = metrics->point_set_map.find(
+      "/tensorflow/cc/saved_model/load_latency_by_stage");
+  if (it == metrics->point_set_map.end()) {
+    return;
+  }
+  for (const auto& point : it->second->points) {
+    std::string path, stage;
+    for (const auto& label : point->labels) {
+      if (label.name == "model_path") {
+        path = label.value;
+      } else if (label.name == "stage") {
+        stage = label.value;
+      }
+    }
+    if (path == model_path) {
+      (*stage_usecs)[stage] += point->histogram_value.sum();
+    }
+  }
+}
+
+// Return true if nodes of op 'op' hold state, such as a variable or a
+// lookup table, that init ops write and other init ops may read.
+bool
+IsStatefulResourceOp(const std::string& op)
+{
+  return (op == "VarHandleOp") || (op == "VariableV2") || (op == "Variable") ||
+         (op == "TemporaryVariable") ||
+         (op.find("HashTable") != std::string::npos);
+}
+
+// Strip the output index and the control dependency marker from the
+// tensor or input name 'name' to get the name of its node.
+std::string
+NodeName(const std::string& name)
+{
+  const size_t start = (!name.empty() && (name[0] == '^')) ? 1 : 0;
+  return name.substr(start, name.find(':', start) - start);
+}
+
+// Group the init ops 'op_names' of 'graph_def' into 'waves' of indices
+// into 'op_names'. The init ops of a wave neither depend on each other
+// nor share a variable or table, so they can run together, and every
+// init op runs in a later wave than the init ops before it in
+// 'op_names' that it depends on or shares state with. Init ops that
+// aren't in the graph are not analyzed and get a wave of their own.
+void
+InitOpWaves(
+    const tensorflow::GraphDef& graph_def,
+    const std::vector<std::string>& op_names,
+    std::vector<std::vector<size_t>>* waves)
+{
+  std::unordered_map<std::string, const tensorflow::NodeDef*> nodes;
+  for (const auto& node : graph_def.node()) {
+    nodes.emplace(node.name(), &node);
+  }
+
+  // The nodes that each init op runs and the stateful nodes among them,
+  // empty if the init op isn't in the graph.
+  std::vector<std::unordered_set<std::string>> ancestors(op_names.size());
+  std::vector<std::unordered_set<std::string>> resources(op_names.size());
+  std::vector<bool> known(op_names.size(), false);
+  for (size_t i = 0; i < op_names.size(); ++i) {
+    std::vector<std::string> pending{NodeName(op_names[i])};
+    known[i] = (nodes.find(pending.back()) != nodes.end());
+    while (known[i] && !pending.empty()) {
+      const std::string name = std::move(pending.back());
+      pending.pop_back();
+      auto it = nodes.find(name);
+      if ((it == nodes.end()) || !ancestors[i].insert(name).second) {
+        continue;
+      }
+      if (IsStatefulResourceOp(it->second->op())) {
+        resources[i].insert(name);
+      }
+      for (const auto& input : it->second->input()) {
+        pending.emplace_back(NodeName(input));
+      }
+    }
+  }
+
+  std::vector<size_t> op_wave(op_names.size(), 0);
+  waves->clear();
+  for (size_t i = 0; i < op_names.size(); ++i) {
+    for (size_t j = 0; j < i; ++j) {
+      bool conflict = !known[i] || !known[j] ||
+                      (ancestors[i].count(NodeName(op_names[j])) != 0) ||
+                      (ancestors[j].count(NodeName(op_names[i])) != 0);
+      for (auto it = resources[i].begin();
+           !conflict && (it != resources[i].end()); ++it) {
+        conflict = (resources[j].count(*it) != 0);
+      }
+      if (conflict) {
+        op_wave[i] = std::max(op_wave[i], op_wave[j] + 1);
+      }
+    }
+    if (op_wave[i] >= waves->size()) {
+      waves->resize(op_wave[i] + 1);
+    }
+    (*waves)[op_wave[i]].push_back(i);
+  }
+}
+
 //
 // ModelImpl
 //
@@ -455,30 +1094,110 @@ class ModelImpl {
   TRITONTF_IOList* Outputs() const { return outputs_; }
   const std::string& DeviceName() const { return device_name_; }
 
-  TRITONTF_Error* MakeCallable(const tensorflow::CallableOptions& opts);
+  // Make the callable that the runs of 'signature_def' use. An empty
+  // 'signature_def' is the signature the model was created with.
+  TRITONTF_Error* MakeCallable(
+      const std::string& signature_def,
+      const tensorflow::CallableOptions& opts);
+
+  // Get the statistics of the allocators of the session devices.
+  TRITONTF_Error* AllocatorStats(
+      std::map<std::string, TRITONTF_AllocatorStats>* stats);
+
+  // Get the inputs and outputs of signature 'signature_def' of a
+  // SavedModel model. The lists are owned by the model.
+  TRITONTF_Error* SignatureIO(
+      const std::string& signature_def, TRITONTF_IOList** inputs,
+      TRITONTF_IOList** outputs);
 
   TRITONTF_Error* Run(
       TRITONTF_TensorList* input_tensors,
       const std::vector<std::string>& output_names,
+      const TRITONTF_RunOptions* run_options,
       TRITONTF_TensorList** output_tensors);
 
-  // Run a single operation.
-  TRITONTF_Error* RunOp(const std::string& op_name);
+  // Run the init ops 'op_names', running the init ops that are
+  // independent of each other together, and return in 'op_usecs' the
+  // time, in microseconds, that each init op took to complete from the
+  // start of the run that included it.
+  TRITONTF_Error* RunInitOps(
+      const std::vector<std::string>& op_names,
+      std::vector<std::pair<std::string, uint64_t>>* op_usecs);
+
+  // Restore the variables of a SavedModel model from the checkpoint of
+  // the SavedModel at 'model_path'.
+  TRITONTF_Error* RestoreVariables(const std::string& model_path);
+
+  // The time, in microseconds, of each phase of the model creation.
+  using LoadPhases = std::vector<std::pair<std::string, uint64_t>>;
+  const LoadPhases& GetLoadPhases() const { return load_phases_; }
+  void SetLoadPhases(LoadPhases&& load_phases)
+  {
+    load_phases_ = std::move(load_phases);
+  }
+
+  // Keep the structure of 'graph_def', the nodes without their
+  // attributes, to find the dependencies between the init ops of a
+  // model that isn't a SavedModel.
+  void SetGraphStructure(const tensorflow::GraphDef& graph_def);
 
  private:
+  // Split 'inputs' along the batch dimension into (up to)
+  // 'micro_batch_count' micro-batches, run them concurrently, or one
+  // after another if 'sequential' is true, and concatenate the outputs
+  // of the micro-batches. If 'cpu_bytes' is not nullptr it returns the
+  // CPU bytes that the micro-batches running at the same time
+  // allocated.
+  TRITONTF_Error* RunMicroBatches(
+      const tensorflow::RunOptions& run_options,
+      const tensorflow::thread::ThreadPoolOptions& thread_pool_options,
+      const std::vector<std::pair<std::string, tensorflow::Tensor>>& inputs,
+      const std::vector<std::string>& output_names,
+      const int micro_batch_count, const bool sequential, int64_t* cpu_bytes,
+      std::vector<tensorflow::Tensor>* outputs);
+
+  // Get the pool that runs the concurrent micro-batches other than the
+  // first, created with 'num_threads' threads on first use.
+  tensorflow::thread::ThreadPool* MicroBatchPool(const int num_threads);
+
   const std::string model_name_;
   std::unique_ptr<tensorflow::SavedModelBundle> bundle_;
   tensorflow::Session* session_;
   TRITONTF_IOList* inputs_;
   TRITONTF_IOList* outputs_;
+  LoadPhases load_phases_;
+  // The graph structure, kept only for a model with init ops and
+  // released once they have run
+  tensorflow::GraphDef graph_structure_;
+
+  // The inputs and outputs of the other signatures that the model
+  // serves, keyed by signature. Collected on first use, guarded by
+  // 'signature_ios_mu_' as the model is shared by the model states.
+  std::mutex signature_ios_mu_;
+  std::map<std::string, std::pair<TRITONTF_IOList*, TRITONTF_IOList*>>
+      signature_ios_;
 
   // Variables for callable
-  bool has_callable_;
   std::string device_name_;
-  tensorflow::Session::CallableHandle callable_;
-  // RunCallable will return all outputs specified in callable option in order,
-  // using map to quickly locate the requested output for each request.
-  std::map<std::string, size_t> output_index_map_;
+  struct Callable {
+    tensorflow::Session::CallableHandle handle_;
+    // RunCallable takes the inputs in the order of the feeds of the
+    // callable option, which is not the order the inputs are listed
+    // in, so each input is placed by its name.
+    std::map<std::string, size_t> input_index_map_;
+    // RunCallable will return all outputs specified in callable option in
+    // order, using map to quickly locate the requested output for each
+    // request.
+    std::map<std::string, size_t> output_index_map_;
+  };
+  // The callable of each signature that has one, keyed by signature.
+  std::map<std::string, Callable> callables_;
+
+  // The threads that run concurrent micro-batches. They block in
+  // Session::Run, so they can't be the threads of the inter-op pool
+  // that the runs schedule their ops on.
+  std::mutex micro_batch_pool_mu_;
+  std::unique_ptr<tensorflow::thread::ThreadPool> micro_batch_pool_;
 };
 
 ModelImpl::ModelImpl(
@@ -487,7 +1206,7 @@ ModelImpl::ModelImpl(
     TRITONTF_IOList* inputs, TRITONTF_IOList* outputs,
     const std::string& device_name)
     : model_name_(model_name), bundle_(std::move(bundle)), inputs_(inputs),
-      outputs_(outputs), has_callable_(false), device_name_(device_name)
+      outputs_(outputs), device_name_(device_name)
 {
   session_ = bundle_->session.release();
 }
@@ -497,15 +1216,15 @@ ModelImpl::ModelImpl(
     TRITONTF_IOList* inputs, TRITONTF_IOList* outputs,
     const std::string& device_name)
     : model_name_(model_name), session_(session), inputs_(inputs),
-      outputs_(outputs), has_callable_(false), device_name_(device_name)
+      outputs_(outputs), device_name_(device_name)
 {
 }
 
 ModelImpl::~ModelImpl()
 {
   if (session_ != nullptr) {
-    if (has_callable_) {
-      session_->ReleaseCallable(callable_).IgnoreError();
+    for (const auto& callable : callables_) {
+      session_->ReleaseCallable(callable.second.handle_).IgnoreError();
     }
     session_->Close().IgnoreError();
     delete session_;
@@ -514,21 +1233,95 @@ ModelImpl::~ModelImpl()
 
   TRITONTF_IOListDelete(inputs_);
   TRITONTF_IOListDelete(outputs_);
+  for (const auto& ios : signature_ios_) {
+    TRITONTF_IOListDelete(ios.second.first);
+    TRITONTF_IOListDelete(ios.second.second);
+  }
 }
 
 TRITONTF_Error*
-ModelImpl::MakeCallable(const tensorflow::CallableOptions& opts)
+ModelImpl::MakeCallable(
+    const std::string& signature_def, const tensorflow::CallableOptions& opts)
 {
-  if (has_callable_) {
-    session_->ReleaseCallable(callable_).IgnoreError();
-    has_callable_ = false;
+  auto it = callables_.find(signature_def);
+  if (it != callables_.end()) {
+    session_->ReleaseCallable(it->second.handle_).IgnoreError();
+    callables_.erase(it);
   }
 
-  RETURN_IF_TF_ERROR(session_->MakeCallable(opts, &callable_));
+  Callable callable;
+  RETURN_IF_TF_ERROR(session_->MakeCallable(opts, &callable.handle_));
+  for (int idx = 0; idx < opts.feed_size(); idx++) {
+    callable.input_index_map_[opts.feed(idx)] = idx;
+  }
   for (int idx = 0; idx < opts.fetch_size(); idx++) {
-    output_index_map_[opts.fetch(idx)] = idx;
+    callable.output_index_map_[opts.fetch(idx)] = idx;
+  }
+  callables_.emplace(signature_def, std::move(callable));
+  return nullptr;
+}
+
+TRITONTF_Error*
+ModelImpl::AllocatorStats(
+    std::map<std::string, TRITONTF_AllocatorStats>* stats)
+{
+  stats->clear();
+
+  const tensorflow::DeviceMgr* device_mgr = nullptr;
+  RETURN_IF_TF_ERROR(session_->LocalDeviceManager(&device_mgr));
+  for (tensorflow::Device* device : device_mgr->ListDevices()) {
+    tensorflow::Allocator* allocator =
+        device->GetAllocator(tensorflow::AllocatorAttributes());
+    if (allocator == nullptr) {
+      continue;
+    }
+    const auto tfstats = allocator->GetStats();
+    if (!tfstats) {
+      continue;
+    }
+    TRITONTF_AllocatorStats& device_stats = (*stats)[device->name()];
+    device_stats.num_allocs_ = tfstats->num_allocs;
+    device_stats.bytes_in_use_ = tfstats->bytes_in_use;
+    device_stats.peak_bytes_in_use_ = tfstats->peak_bytes_in_use;
+    device_stats.largest_alloc_size_ = tfstats->largest_alloc_size;
   }
-  has_callable_ = true;
+
+  return nullptr;
+}
+
+TRITONTF_Error*
+ModelImpl::SignatureIO(
+    const std::string& signature_def, TRITONTF_IOList** inputs,
+    TRITONTF_IOList** outputs)
+{
+  std::lock_guard<std::mutex> lock(signature_ios_mu_);
+  auto it = signature_ios_.find(signature_def);
+  if (it == signature_ios_.end()) {
+    if (bundle_ == nullptr) {
+      return TRITONTF_ErrorNew(
+          "model '" + model_name_ + "' doesn't have signatures");
+    }
+    const auto& signature_defs = bundle_->meta_graph_def.signature_def();
+    auto sig_itr = signature_defs.find(signature_def);
+    if (sig_itr == signature_defs.end()) {
+      return TRITONTF_ErrorNew(
+          "unable to load model '" + model_name_ + "', expected '" +
+          signature_def + "' signature");
+    }
+    TRITONTF_IOList* sig_inputs = nullptr;
+    TRITONTF_IOList* sig_outputs = nullptr;
+    TRITONTF_Error* err = CollectSignatureIO(
+        model_name_, sig_itr->second, &sig_inputs, &sig_outputs);
+    if (err != nullptr) {
+      return err;
+    }
+    it = signature_ios_
+             .emplace(signature_def, std::make_pair(sig_inputs, sig_outputs))
+             .first;
+  }
+
+  *inputs = it->second.first;
+  *outputs = it->second.second;
   return nullptr;
 }
 
@@ -536,29 +1329,52 @@ TRITONTF_Error*
 ModelImpl::Run(
     TRITONTF_TensorList* input_tensors,
     const std::vector<std::string>& output_names,
+    const TRITONTF_RunOptions* run_options,
     TRITONTF_TensorList** output_tensors)
 {
   // I/O needs to be prepared differently for callable
-  if (has_callable_) {
-    std::vector<tensorflow::Tensor> tfinputs;
+  const std::string signature_def =
+      ((run_options != nullptr) && (run_options->signature_def_ != nullptr))
+          ? run_options->signature_def_
+          : "";
+  auto callable_itr = callables_.find(signature_def);
+  if (callable_itr != callables_.end()) {
+    Callable& callable = callable_itr->second;
+    std::vector<tensorflow::Tensor> tfinputs(callable.input_index_map_.size());
 
     for (TRITONTF_TensorList* itr = input_tensors; itr != nullptr;
          itr = itr->next_) {
       if (itr->tensor_ != nullptr) {
         TensorImpl* tensor = reinterpret_cast<TensorImpl*>(itr->tensor_);
-        tfinputs.emplace_back(std::move(tensor->TFTensor()));
+        const auto iidx = callable.input_index_map_.find(tensor->Name());
+        if (iidx == callable.input_index_map_.end()) {
+          const std::string name = tensor->Name();
+          TRITONTF_TensorListDelete(input_tensors);
+          return TRITONTF_ErrorNew(
+              "input '" + name + "' is not fed by the callable of model '" +
+              model_name_ + "'");
+        }
+        tfinputs[iidx->second] = std::move(tensor->TFTensor());
       }
     }
     TRITONTF_TensorListDelete(input_tensors);
 
     tensorflow::RunMetadata meta_data;
     std::vector<tensorflow::Tensor> tfoutputs;
-    RETURN_IF_TF_ERROR(
-        session_->RunCallable(callable_, tfinputs, &tfoutputs, &meta_data));
+    if ((run_options != nullptr) && (run_options->thread_pools_ != nullptr)) {
+      ThreadPoolsImpl* pools =
+          reinterpret_cast<ThreadPoolsImpl*>(run_options->thread_pools_);
+      RETURN_IF_TF_ERROR(session_->RunCallable(
+          callable.handle_, tfinputs, &tfoutputs, &meta_data,
+          pools->Options()));
+    } else {
+      RETURN_IF_TF_ERROR(session_->RunCallable(
+          callable.handle_, tfinputs, &tfoutputs, &meta_data));
+    }
 
     *output_tensors = nullptr;
     for (auto ri = output_names.rbegin(); ri != output_names.rend(); ++ri) {
-      const auto oidx = output_index_map_[*ri];
+      const auto oidx = callable.output_index_map_[*ri];
       TRITONTF_Tensor* tensor = reinterpret_cast<TRITONTF_Tensor*>(
           new TensorImpl(std::move(tfoutputs[oidx])));
       *output_tensors = TRITONTF_TensorListNew(tensor, *output_tensors);
@@ -582,8 +1398,45 @@ ModelImpl::Run(
     }
     TRITONTF_TensorListDelete(input_tensors);
 
+    // Bound the run so that it doesn't keep computing results that
+    // can no longer be delivered in time.
+    tensorflow::RunOptions tf_run_options;
+    if ((run_options != nullptr) && (run_options->timeout_in_ms_ > 0)) {
+      tf_run_options.set_timeout_in_ms(run_options->timeout_in_ms_);
+    }
+    // The memory the run allocates is only reported in the step stats.
+    int64_t* cpu_bytes =
+        (run_options != nullptr) ? run_options->cpu_bytes_ : nullptr;
+    if (cpu_bytes != nullptr) {
+      tf_run_options.set_trace_level(tensorflow::RunOptions::SOFTWARE_TRACE);
+      *cpu_bytes = 0;
+    }
+
+    tensorflow::thread::ThreadPoolOptions thread_pool_options;
+    if ((run_options != nullptr) && (run_options->thread_pools_ != nullptr)) {
+      thread_pool_options =
+          reinterpret_cast<ThreadPoolsImpl*>(run_options->thread_pools_)
+              ->Options();
+    }
+
     std::vector<tensorflow::Tensor> tfoutputs;
-    RETURN_IF_TF_ERROR(session_->Run(tfinputs, output_names, {}, &tfoutputs));
+    if ((run_options != nullptr) && (run_options->micro_batch_count_ > 1)) {
+      TRITONTF_Error* err = RunMicroBatches(
+          tf_run_options, thread_pool_options, tfinputs, output_names,
+          run_options->micro_batch_count_,
+          run_options->sequential_micro_batches_, cpu_bytes, &tfoutputs);
+      if (err != nullptr) {
+        return err;
+      }
+    } else {
+      tensorflow::RunMetadata meta_data;
+      RETURN_IF_TF_ERROR(session_->Run(
+          tf_run_options, tfinputs, output_names, {}, &tfoutputs, &meta_data,
+          thread_pool_options));
+      if (cpu_bytes != nullptr) {
+        *cpu_bytes = StepCPUBytes(meta_data);
+      }
+    }
 
     *output_tensors = nullptr;
     for (std::vector<tensorflow::Tensor>::reverse_iterator ri =
@@ -598,10 +1451,250 @@ ModelImpl::Run(
   return nullptr;
 }
 
+tensorflow::thread::ThreadPool*
+ModelImpl::MicroBatchPool(const int num_threads)
+{
+  // Concurrent micro-batches are only run with the configured
+  // micro-batch count, which the models sharing the session agree on,
+  // so the pool is sized on first use. Micro-batches of runs that
+  // overlap wait for a free thread.
+  std::lock_guard<std::mutex> lock(micro_batch_pool_mu_);
+  if (micro_batch_pool_ == nullptr) {
+    micro_batch_pool_.reset(new tensorflow::thread::ThreadPool(
+        tensorflow::Env::Default(), model_name_ + "_micro_batch",
+        std::max(num_threads, 1)));
+  }
+  return micro_batch_pool_.get();
+}
+
 TRITONTF_Error*
-ModelImpl::RunOp(const std::string& op_name)
+ModelImpl::RunMicroBatches(
+    const tensorflow::RunOptions& run_options,
+    const tensorflow::thread::ThreadPoolOptions& thread_pool_options,
+    const std::vector<std::pair<std::string, tensorflow::Tensor>>& inputs,
+    const std::vector<std::string>& output_names, const int micro_batch_count,
+    const bool sequential, int64_t* cpu_bytes,
+    std::vector<tensorflow::Tensor>* outputs)
 {
-  RETURN_IF_TF_ERROR(session_->Run({}, {}, {op_name}, nullptr));
+  int64_t batch_size = 0;
+  for (const auto& input : inputs) {
+    if ((input.second.dims() == 0) ||
+        ((batch_size != 0) && (input.second.dim_size(0) != batch_size))) {
+      return TRITONTF_ErrorNew(
+          "unable to split batch into micro-batches, input '" + input.first +
+          "' doesn't have the batch dimension");
+    }
+    batch_size = input.second.dim_size(0);
+  }
+
+  // Rows are distributed as evenly as possible, the first 'remainder'
+  // micro-batches get one additional row.
+  const int64_t count =
+      std::min(static_cast<int64_t>(micro_batch_count), batch_size);
+  if (count <= 1) {
+    tensorflow::RunMetadata meta_data;
+    RETURN_IF_TF_ERROR(session_->Run(
+        run_options, inputs, output_names, {}, outputs, &meta_data,
+        thread_pool_options));
+    if (cpu_bytes != nullptr) {
+      *cpu_bytes = StepCPUBytes(meta_data);
+    }
+    return nullptr;
+  }
+
+  const int64_t base_size = batch_size / count;
+  const int64_t remainder = batch_size % count;
+  std::vector<std::vector<std::pair<std::string, tensorflow::Tensor>>>
+      micro_inputs(count);
+  int64_t start = 0;
+  for (int64_t m = 0; m < count; ++m) {
+    const int64_t size = base_size + ((m < remainder) ? 1 : 0);
+    for (const auto& input : inputs) {
+      // A slice shares the buffer of the batch tensor, but kernels may
+      // require aligned buffers so copy the slice if it isn't.
+      tensorflow::Tensor slice = input.second.Slice(start, start + size);
+      if (!slice.IsAligned()) {
+        slice = tensorflow::tensor::DeepCopy(slice);
+      }
+      micro_inputs[m].emplace_back(input.first, std::move(slice));
+    }
+    start += size;
+  }
+
+  // Session::Run is thread-safe so the micro-batches share the
+  // session, each run on a thread of the micro-batch pool except the
+  // first which runs on the calling thread. Sequential micro-batches
+  // all run on the calling thread so that only one of them holds its
+  // intermediate tensors at a time.
+  std::vector<std::vector<tensorflow::Tensor>> micro_outputs(count);
+  std::vector<tensorflow::Status> statuses(count);
+  std::vector<tensorflow::RunMetadata> meta_data(count);
+  if (sequential) {
+    for (int64_t m = 0; m < count; ++m) {
+      statuses[m] = session_->Run(
+          run_options, micro_inputs[m], output_names, {}, &micro_outputs[m],
+          &meta_data[m], thread_pool_options);
+      RETURN_IF_TF_ERROR(statuses[m]);
+    }
+  } else {
+    // The pool is sized for the configured count rather than for the
+    // count of this batch, which is lower for a batch that has fewer
+    // rows.
+    tensorflow::thread::ThreadPool* pool =
+        MicroBatchPool(micro_batch_count - 1);
+    tensorflow::BlockingCounter pending(count - 1);
+    for (int64_t m = 1; m < count; ++m) {
+      pool->Schedule([&, m]() {
+        statuses[m] = session_->Run(
+            run_options, micro_inputs[m], output_names, {}, &micro_outputs[m],
+            &meta_data[m], thread_pool_options);
+        pending.DecrementCount();
+      });
+    }
+    statuses[0] = session_->Run(
+        run_options, micro_inputs[0], output_names, {}, &micro_outputs[0],
+        &meta_data[0], thread_pool_options);
+    pending.Wait();
+    for (const auto& status : statuses) {
+      RETURN_IF_TF_ERROR(status);
+    }
+  }
+  if (cpu_bytes != nullptr) {
+    *cpu_bytes = 0;
+    for (const auto& micro_meta_data : meta_data) {
+      const int64_t bytes = StepCPUBytes(micro_meta_data);
+      *cpu_bytes = sequential ? std::max(*cpu_bytes, bytes)
+                              : (*cpu_bytes + bytes);
+    }
+  }
+
+  outputs->clear();
+  for (size_t oidx = 0; oidx < output_names.size(); ++oidx) {
+    std::vector<tensorflow::Tensor> parts;
+    parts.reserve(count);
+    for (int64_t m = 0; m < count; ++m) {
+      parts.emplace_back(std::move(micro_outputs[m][oidx]));
+    }
+    tensorflow::Tensor output;
+    RETURN_IF_TF_ERROR(tensorflow::tensor::Concat(parts, &output));
+    outputs->emplace_back(std::move(output));
+  }
+
+  return nullptr;
+}
+
+void
+ModelImpl::SetGraphStructure(const tensorflow::GraphDef& graph_def)
+{
+  graph_structure_.Clear();
+  for (const auto& node : graph_def.node()) {
+    tensorflow::NodeDef* structure_node = graph_structure_.add_node();
+    structure_node->set_name(node.name());
+    structure_node->set_op(node.op());
+    *structure_node->mutable_input() = node.input();
+  }
+}
+
+TRITONTF_Error*
+ModelImpl::RunInitOps(
+    const std::vector<std::string>& op_names,
+    std::vector<std::pair<std::string, uint64_t>>* op_usecs)
+{
+  const tensorflow::GraphDef& graph_def =
+      (bundle_ != nullptr) ? bundle_->meta_graph_def.graph_def()
+                           : graph_structure_;
+  std::vector<std::vector<size_t>> waves;
+  InitOpWaves(graph_def, op_names, &waves);
+  LOG(INFO) << "running " << op_names.size() << " init ops of model "
+            << model_name_ << " in " << waves.size() << " runs";
+
+  // Trace the runs of more than one init op to find when each of them
+  // completed.
+  op_usecs->assign(op_names.size(), {});
+  for (const auto& wave : waves) {
+    std::vector<std::string> targets;
+    for (const size_t idx : wave) {
+      targets.push_back(op_names[idx]);
+    }
+    tensorflow::RunOptions run_options;
+    if (wave.size() > 1) {
+      run_options.set_trace_level(tensorflow::RunOptions::SOFTWARE_TRACE);
+    }
+    tensorflow::RunMetadata meta_data;
+    const uint64_t start_us = tensorflow::Env::Default()->NowMicros();
+    RETURN_IF_TF_ERROR(
+        session_->Run(run_options, {}, {}, targets, nullptr, &meta_data));
+    const uint64_t run_usecs =
+        tensorflow::Env::Default()->NowMicros() - start_us;
+
+    std::unordered_map<std::string, uint64_t> end_usecs;
+    for (const auto& dev_stats : meta_data.step_stats().dev_stats()) {
+      for (const auto& node_stats : dev_stats.node_stats()) {
+        const int64_t end_us =
+            node_stats.all_start_micros() + node_stats.all_end_rel_micros();
+        if (end_us > static_cast<int64_t>(start_us)) {
+          uint64_t& usecs = end_usecs[node_stats.node_name()];
+          usecs = std::max(usecs, end_us - start_us);
+        }
+      }
+    }
+    for (const size_t idx : wave) {
+      // Grappler may have renamed or removed the node, in which case
+      // the init op took at most the whole run.
+      auto it = end_usecs.find(NodeName(op_names[idx]));
+      (*op_usecs)[idx] = std::make_pair(
+          op_names[idx], (it != end_usecs.end())
+                             ? std::min(it->second, run_usecs)
+                             : run_usecs);
+    }
+  }
+
+  graph_structure_.Clear();
+  return nullptr;
+}
+
+TRITONTF_Error*
+ModelImpl::RestoreVariables(const std::string& model_path)
+{
+  if ((bundle_ == nullptr) || !bundle_->meta_graph_def.has_saver_def()) {
+    return TRITONTF_ErrorNew(
+        "model '" + model_name_ + "' has no variables to restore");
+  }
+
+  // Run the restore op of the saver the same way the SavedModel loader
+  // does, pointing it at the checkpoint of the new SavedModel.
+  const tensorflow::SaverDef& saver_def = bundle_->meta_graph_def.saver_def();
+  tensorflow::Tensor variables_path(
+      tensorflow::DT_STRING, tensorflow::TensorShape({}));
+  variables_path.scalar<tensorflow::tstring>()() = tensorflow::io::JoinPath(
+      model_path, tensorflow::kSavedModelVariablesDirectory,
+      tensorflow::kSavedModelVariablesFilename);
+  RETURN_IF_TF_ERROR(session_->Run(
+      {{saver_def.filename_tensor_name(), variables_path}}, {},
+      {saver_def.restore_op_name()}, nullptr));
+
+  // Run the init op again, feeding it the assets of the new SavedModel,
+  // so that lookup tables and the other state it builds match them. A
+  // table that is already initialized with different data fails the
+  // init op.
+  std::string init_op_name;
+  RETURN_IF_TF_ERROR(tensorflow::internal::GetInitOp(
+      model_path, bundle_->meta_graph_def, &init_op_name));
+  if (!init_op_name.empty()) {
+    std::vector<tensorflow::AssetFileDef> asset_file_defs;
+    RETURN_IF_TF_ERROR(tensorflow::internal::GetAssetFileDefs(
+        bundle_->meta_graph_def, &asset_file_defs));
+    std::vector<std::pair<std::string, tensorflow::Tensor>> inputs;
+    for (const auto& asset_file_def : asset_file_defs) {
+      tensorflow::Tensor asset_path(
+          tensorflow::DT_STRING, tensorflow::TensorShape({}));
+      asset_path.scalar<tensorflow::tstring>()() = tensorflow::io::JoinPath(
+          model_path, tensorflow::kSavedModelAssetsDirectory,
+          asset_file_def.filename());
+      inputs.emplace_back(asset_file_def.tensor_info().name(), asset_path);
+    }
+    RETURN_IF_TF_ERROR(session_->Run(inputs, {}, {init_op_name}, nullptr));
+  }
   return nullptr;
 }
 
@@ -617,6 +1710,7 @@ TRITONTF_ErrorNew(const std::string& str)
   TRITONTF_Error* error = new TRITONTF_Error;
   error->msg_ = new char[str.size() + 1];
   strcpy(error->msg_, str.c_str());
+  error->timed_out_ = false;
   return error;
 }
 
@@ -740,13 +1834,14 @@ TRITONTF_TensorListDelete(TRITONTF_TensorList* list)
 TRITONTF_Tensor*
 TRITONTF_TensorNew(
     const char* name, TRITONTF_DataType dtype, size_t shape_rank,
-    int64_t* shape_dims, const int tf_gpu_id)
+    int64_t* shape_dims, const int tf_gpu_id, const int numa_node)
 {
   TRITONTF_Shape* shape = TRITONTF_ShapeNew(shape_rank, shape_dims);
   tensorflow::TensorShape tfshape;
   ConvertShape(shape, &tfshape);
 
-  TensorImpl* tensor = new TensorImpl(name, dtype, shape, tfshape, tf_gpu_id);
+  TensorImpl* tensor =
+      new TensorImpl(name, dtype, shape, tfshape, tf_gpu_id, numa_node);
   // If data type is non-string, make sure TensorImpl contains valid TF tensor
   if (dtype != TRITONTF_DataType::TRITONTF_TYPE_STRING) {
     // tensor's byte size is set to value required and it is independent to
@@ -823,6 +1918,139 @@ TRITONTF_TensorSetString(
   t->SetString(idx, str);
 }
 
+void
+TRITONTF_TensorSetStrings(
+    TRITONTF_Tensor* tensor, size_t idx, size_t count, const char** strs,
+    const size_t* lengths)
+{
+  TensorImpl* t = reinterpret_cast<TensorImpl*>(tensor);
+  t->SetStrings(idx, count, strs, lengths);
+}
+
+//
+// TRITONTF_Memory
+//
+TRITONTF_Error*
+TRITONTF_EnableHugePages()
+{
+  // The visitors are only used by the BFC CPU allocators created
+  // afterwards, which advise regions rather than individual tensors.
+  // The CPU allocators are only BFC allocators if
+  // TF_CPU_ALLOCATOR_USE_BFC is set, a value set by the user is kept.
+  static std::once_flag enabled;
+  std::call_once(enabled, []() {
+    setenv("TF_CPU_ALLOCATOR_USE_BFC", "true", 0 /* overwrite */);
+    tensorflow::ProcessState::singleton()->AddCPUAllocVisitor(AdviseHugePages);
+    tensorflow::ProcessState::singleton()->AddCPUFreeVisitor(
+        ReleaseHugePages);
+    huge_pages_enabled = true;
+  });
+  return nullptr;
+}
+
+size_t
+TRITONTF_HugePageByteSize()
+{
+  std::lock_guard<std::mutex> lk(huge_page_mu);
+  return huge_page_bytes;
+}
+
+size_t
+TRITONTF_HugePagePeakByteSize()
+{
+  std::lock_guard<std::mutex> lk(huge_page_mu);
+  return huge_page_peak_bytes;
+}
+
+void
+TRITONTF_EnableCPUAllocatorStats()
+{
+  tensorflow::EnableCPUAllocatorStats();
+}
+
+//
+// TRITONTF_OneDNN
+//
+TRITONTF_Error*
+TRITONTF_SetOneDNNOptions(
+    const int enable, const int primitive_cache_capacity,
+    const int native_format)
+{
+  const std::vector<std::pair<const char*, int>> options{
+      {"TF_ENABLE_ONEDNN_OPTS", enable},
+      {"ONEDNN_PRIMITIVE_CACHE_CAPACITY", primitive_cache_capacity},
+      {"TF_ENABLE_MKL_NATIVE_FORMAT", native_format}};
+  for (const auto& option : options) {
+    if (option.second < 0) {
+      continue;
+    }
+    if (setenv(
+            option.first, std::to_string(option.second).c_str(),
+            1 /* overwrite */) != 0) {
+      return TRITONTF_ErrorNew(
+          std::string("failed to set ") + option.first + ": " +
+          strerror(errno));
+    }
+  }
+
+  return nullptr;
+}
+
+bool
+TRITONTF_OneDNNEnabled()
+{
+  return tensorflow::IsMKLEnabled();
+}
+
+TRITONTF_Error*
+TRITONTF_SetAutoMixedPrecisionLists(
+    const char* allow_list_add, const char* allow_list_remove,
+    const char* deny_list_add, const char* deny_list_remove)
+{
+  const std::vector<std::pair<const char*, const char*>> lists{
+      {"TF_AUTO_MIXED_PRECISION_GRAPH_REWRITE_ALLOWLIST_ADD", allow_list_add},
+      {"TF_AUTO_MIXED_PRECISION_GRAPH_REWRITE_ALLOWLIST_REMOVE",
+       allow_list_remove},
+      {"TF_AUTO_MIXED_PRECISION_GRAPH_REWRITE_DENYLIST_ADD", deny_list_add},
+      {"TF_AUTO_MIXED_PRECISION_GRAPH_REWRITE_DENYLIST_REMOVE",
+       deny_list_remove}};
+  for (const auto& list : lists) {
+    if ((list.second == nullptr) || (list.second[0] == '\0')) {
+      continue;
+    }
+    if (setenv(list.first, list.second, 1 /* overwrite */) != 0) {
+      return TRITONTF_ErrorNew(
+          std::string("failed to set ") + list.first + ": " + strerror(errno));
+    }
+  }
+
+  return nullptr;
+}
+
+//
+// TRITONTF_ThreadPools
+//
+TRITONTF_Error*
+TRITONTF_ThreadPoolsNew(
+    TRITONTF_ThreadPools** thread_pools, const char* name,
+    const int num_intra_threads, const int num_inter_threads,
+    const int* cpu_ids, const size_t cpu_count, const int numa_node)
+{
+  ThreadPoolsImpl* pools = new ThreadPoolsImpl(
+      name, num_intra_threads, num_inter_threads,
+      std::vector<int>(cpu_ids, cpu_ids + cpu_count), numa_node);
+  *thread_pools = reinterpret_cast<TRITONTF_ThreadPools*>(pools);
+  return nullptr;
+}
+
+void
+TRITONTF_ThreadPoolsDelete(TRITONTF_ThreadPools* thread_pools)
+{
+  if (thread_pools != nullptr) {
+    delete reinterpret_cast<ThreadPoolsImpl*>(thread_pools);
+  }
+}
+
 //
 // TRITONTF_Model
 //
@@ -836,17 +2064,23 @@ TRITONTF_ModelCreateFromGraphDef(
     const float per_process_gpu_memory_fraction,
     const bool allow_soft_placement,
     const std::map<int, std::vector<float>>& memory_limit_mb,
-    const TRITONTF_TFTRTConfig* tftrt_config, const bool auto_mixed_precision)
+    const TRITONTF_TFTRTConfig* tftrt_config, const bool auto_mixed_precision,
+    const bool cpu_auto_mixed_precision,
+    const TRITONTF_GrapplerConfig* grappler_config, const char** keep_nodes,
+    const size_t keep_node_count, const bool has_init_ops)
 {
+  LoadPhaseTimer timer;
   tensorflow::SessionOptions session_options;
   NewSessionOptions(
       num_intra_threads, num_inter_threads, use_per_session_threads,
       has_graph_level, graph_level, allow_gpu_memory_growth,
       per_process_gpu_memory_fraction, allow_soft_placement, memory_limit_mb,
-      tftrt_config, auto_mixed_precision, &session_options);
+      tftrt_config, auto_mixed_precision, cpu_auto_mixed_precision,
+      grappler_config, &session_options);
 
   tensorflow::Session* session;
   RETURN_IF_TF_ERROR(tensorflow::NewSession(session_options, &session));
+  timer.EndPhase("new_session");
 
   tensorflow::GraphDef graph_def;
   RETURN_IF_TF_ERROR(tensorflow::ReadBinaryProto(
@@ -855,6 +2089,15 @@ TRITONTF_ModelCreateFromGraphDef(
     return TRITONTF_ErrorNew(
         "model " + std::string(model_name) + " has an empty network");
   }
+  timer.EndPhase("read_graph");
+
+  if (keep_node_count != 0) {
+    const int node_count = graph_def.node_size();
+    PruneGraphDef(keep_nodes, keep_node_count, &graph_def);
+    LOG(INFO) << "pruned model " << model_name << " from " << node_count
+              << " to " << graph_def.node_size() << " nodes";
+    timer.EndPhase("prune_graph");
+  }
 
   if (device_id != TRITONTF_MODEL_DEVICE) {
     // Clear the device field from the graphdef so that the default device
@@ -875,6 +2118,7 @@ TRITONTF_ModelCreateFromGraphDef(
   }
 
   RETURN_IF_TF_ERROR(session->Create(graph_def));
+  timer.EndPhase("create_session");
 
   // Go through all graph nodes and collect the possible inputs and
   // outputs. We use this to verify the requested inputs and outputs
@@ -903,6 +2147,10 @@ TRITONTF_ModelCreateFromGraphDef(
   }
   ModelImpl* model = new ModelImpl(
       model_name, session, potential_inputs, potential_outputs, device_name);
+  if (has_init_ops) {
+    model->SetGraphStructure(graph_def);
+  }
+  model->SetLoadPhases(timer.Release());
   *tritontf_model = reinterpret_cast<TRITONTF_Model*>(model);
 
   return nullptr;
@@ -919,14 +2167,19 @@ TRITONTF_ModelCreateFromSavedModel(
     const float per_process_gpu_memory_fraction,
     const bool allow_soft_placement,
     const std::map<int, std::vector<float>>& memory_limit_mb,
-    const TRITONTF_TFTRTConfig* tftrt_config, const bool auto_mixed_precision)
+    const TRITONTF_TFTRTConfig* tftrt_config, const bool auto_mixed_precision,
+    const bool cpu_auto_mixed_precision,
+    const TRITONTF_GrapplerConfig* grappler_config,
+    const bool freeze_variables)
 {
+  LoadPhaseTimer timer;
   tensorflow::SessionOptions session_options;
   NewSessionOptions(
       num_intra_threads, num_inter_threads, use_per_session_threads,
       has_graph_level, graph_level, allow_gpu_memory_growth,
       per_process_gpu_memory_fraction, allow_soft_placement, memory_limit_mb,
-      tftrt_config, auto_mixed_precision, &session_options);
+      tftrt_config, auto_mixed_precision, cpu_auto_mixed_precision,
+      grappler_config, &session_options);
 
 
   if (device_id != TRITONTF_MODEL_DEVICE) {
@@ -962,10 +2215,24 @@ TRITONTF_ModelCreateFromSavedModel(
                                      : graph_tag;
   saved_model_tags.insert(TAG_TO_USE);
 
+  // The loader reads the graph, creates the session and restores the
+  // variables in its 'restore_graph' stage and runs the init op in its
+  // 'init_graph' stage.
+  std::map<std::string, double> stage_usecs_before, stage_usecs_after;
+  SavedModelLoadStageUsecs(model_path, &stage_usecs_before);
   tensorflow::RunOptions run_options;
   RETURN_IF_TF_ERROR(tensorflow::LoadSavedModel(
       session_options, run_options, model_path, saved_model_tags,
       bundle.get()));
+  timer.EndPhase("load_saved_model");
+  SavedModelLoadStageUsecs(model_path, &stage_usecs_after);
+  for (const auto& stage : stage_usecs_after) {
+    const double usecs = stage.second - stage_usecs_before[stage.first];
+    if (usecs > 0) {
+      timer.AddPhase(
+          "load_saved_model/" + stage.first, static_cast<uint64_t>(usecs));
+    }
+  }
 
   // Verify that the bundle has the correct tag
   bool found_serve_tag = false;
@@ -1016,56 +2283,21 @@ TRITONTF_ModelCreateFromSavedModel(
 
   const tensorflow::SignatureDef& def = sig_itr->second;
 
-  // Collect the inputs...
   TRITONTF_IOList* inputs = nullptr;
-  for (const auto& sin : def.inputs()) {
-    inputs = TRITONTF_IOListNew(
-        sin.first.c_str(), sin.second.name().c_str(), inputs);
-    TRITONTF_IO* io = inputs->io_;
-
-    const TRITONTF_DataType dt = ConvertDataType(sin.second.dtype());
-    if (dt == TRITONTF_DataType::TRITONTF_TYPE_INVALID) {
-      return TRITONTF_ErrorNew(
-          "unable to process input '" + std::string(io->name_) + "' for '" +
-          std::string(model_name) + "', unsupported datatype '" +
-          tensorflow::DataType_Name(sin.second.dtype()) + "'");
-    }
-
-    io->data_type_ = dt;
-
-    const tensorflow::TensorShapeProto& shape = sin.second.tensor_shape();
-    int64_t shape_dims[shape.dim().size()];
-    for (int i = 0; i < shape.dim().size(); ++i) {
-      shape_dims[i] = shape.dim(i).size();
-    }
-
-    io->shape_ = TRITONTF_ShapeNew(shape.dim().size(), shape_dims);
-  }
-
-  // Collect the outputs...
   TRITONTF_IOList* outputs = nullptr;
-  for (const auto& sout : def.outputs()) {
-    outputs = TRITONTF_IOListNew(
-        sout.first.c_str(), sout.second.name().c_str(), outputs);
-    TRITONTF_IO* io = outputs->io_;
-
-    const TRITONTF_DataType dt = ConvertDataType(sout.second.dtype());
-    if (dt == TRITONTF_DataType::TRITONTF_TYPE_INVALID) {
-      return TRITONTF_ErrorNew(
-          "unable to process output '" + std::string(io->name_) + "' for '" +
-          std::string(model_name) + "', unsupported datatype '" +
-          tensorflow::DataType_Name(sout.second.dtype()) + "'");
-    }
-
-    io->data_type_ = dt;
+  TRITONTF_Error* io_err =
+      CollectSignatureIO(model_name, def, &inputs, &outputs);
+  if (io_err != nullptr) {
+    return io_err;
+  }
 
-    const tensorflow::TensorShapeProto& shape = sout.second.tensor_shape();
-    int64_t shape_dims[shape.dim().size()];
-    for (int i = 0; i < shape.dim().size(); ++i) {
-      shape_dims[i] = shape.dim(i).size();
+  if (freeze_variables) {
+    TRITONTF_Error* err = FreezeSavedModelSession(
+        model_name, device_id, session_options, bundle.get());
+    if (err != nullptr) {
+      return err;
     }
-
-    io->shape_ = TRITONTF_ShapeNew(shape.dim().size(), shape_dims);
+    timer.EndPhase("freeze_variables");
   }
 
   std::string device_name;
@@ -1079,6 +2311,7 @@ TRITONTF_ModelCreateFromSavedModel(
   }
   ModelImpl* model = new ModelImpl(
       model_name, std::move(bundle), inputs, outputs, device_name);
+  model->SetLoadPhases(timer.Release());
   *tritontf_model = reinterpret_cast<TRITONTF_Model*>(model);
 
   return nullptr;
@@ -1093,6 +2326,47 @@ TRITONTF_ModelDelete(TRITONTF_Model* model)
   }
 }
 
+void
+TRITONTF_GrapplerPassTimes(std::map<std::string, uint64_t>* pass_usecs)
+{
+  pass_usecs->clear();
+
+  // Grappler records the time of each pass it runs in the graph
+  // optimization counter, labeled with kind "Grappler".
+  tensorflow::monitoring::CollectionRegistry::CollectMetricsOptions options;
+  options.collect_metric_descriptors = false;
+  auto metrics =
+      tensorflow::monitoring::CollectionRegistry::Default()->CollectMetrics(
+          options);
+  auto it = metrics->point_set_map.find(
+      "/tensorflow/core/graph_optimization_usecs");
+  if (it == metrics->point_set_map.end()) {
+    return;
+  }
+  for (const auto& point : it->second->points) {
+    std::string kind, name;
+    for (const auto& label : point->labels) {
+      if (label.name == "kind") {
+        kind = label.value;
+      } else if (label.name == "name") {
+        name = label.value;
+      }
+    }
+    if (kind == "Grappler") {
+      (*pass_usecs)[name] += point->int64_value;
+    }
+  }
+}
+
+TRITONTF_Error*
+TRITONTF_ModelAllocatorStats(
+    TRITONTF_Model* model,
+    std::map<std::string, TRITONTF_AllocatorStats>* stats)
+{
+  ModelImpl* m = reinterpret_cast<ModelImpl*>(model);
+  return m->AllocatorStats(stats);
+}
+
 TRITONTF_IOList*
 TRITONTF_ModelInputs(TRITONTF_Model* model)
 {
@@ -1112,7 +2386,7 @@ TRITONTF_ModelMakeCallable(
     TRITONTF_Model* model, const char** input_names,
     const TRITONTF_DataType* input_types, const size_t num_inputs,
     const char** output_names, const TRITONTF_DataType* output_types,
-    const size_t num_outputs)
+    const size_t num_outputs, const char* signature_def)
 {
   ModelImpl* m = reinterpret_cast<ModelImpl*>(model);
 
@@ -1143,13 +2417,24 @@ TRITONTF_ModelMakeCallable(
   // will have to synchronize after the callable is run.
   opts.set_fetch_skip_sync(true);
 
-  return m->MakeCallable(opts);
+  return m->MakeCallable(
+      (signature_def == nullptr) ? "" : signature_def, opts);
+}
+
+TRITONTF_Error*
+TRITONTF_ModelSignatureIO(
+    TRITONTF_Model* model, const char* signature_def, TRITONTF_IOList** inputs,
+    TRITONTF_IOList** outputs)
+{
+  ModelImpl* m = reinterpret_cast<ModelImpl*>(model);
+  return m->SignatureIO(signature_def, inputs, outputs);
 }
 
 TRITONTF_Error*
 TRITONTF_ModelRun(
     TRITONTF_Model* model, TRITONTF_TensorList* input_tensors,
     size_t num_outputs, const char** output_names,
+    const TRITONTF_RunOptions* run_options,
     TRITONTF_TensorList** output_tensors)
 {
   ModelImpl* m = reinterpret_cast<ModelImpl*>(model);
@@ -1159,25 +2444,65 @@ TRITONTF_ModelRun(
     output_tensor_names.emplace_back(output_names[i]);
   }
 
-  return m->Run(input_tensors, output_tensor_names, output_tensors);
+  return m->Run(
+      input_tensors, output_tensor_names, run_options, output_tensors);
 }
 
 TRITONTF_Error*
 TRITONTF_ModelInitialize(
     TRITONTF_Model* model, size_t num_init_operations,
-    const char** init_operation_names)
+    const char** init_operation_names,
+    std::vector<std::pair<std::string, uint64_t>>* op_usecs)
 {
   ModelImpl* m = reinterpret_cast<ModelImpl*>(model);
-  for (auto i = 0; i < num_init_operations; i++) {
-    TRITONTF_Error* err = m->RunOp(init_operation_names[i]);
-    if (err != nullptr) {
-      return err;
-    }
+  std::vector<std::string> op_names;
+  for (size_t i = 0; i < num_init_operations; i++) {
+    op_names.emplace_back(init_operation_names[i]);
   }
 
+  return m->RunInitOps(op_names, op_usecs);
+}
+
+TRITONTF_Error*
+TRITONTF_SavedModelGraphHash(
+    const char* model_path, const char* graph_tag, uint64_t* hash)
+{
+  const std::string tag = (strcmp(graph_tag, "") == 0)
+                              ? tensorflow::kSavedModelTagServe
+                              : graph_tag;
+  tensorflow::MetaGraphDef meta_graph_def;
+  RETURN_IF_TF_ERROR(tensorflow::ReadMetaGraphDefFromSavedModel(
+      model_path, {tag}, &meta_graph_def));
+
+  // The meta info only describes the export, such as the TensorFlow
+  // version, and doesn't change what the model computes.
+  meta_graph_def.clear_meta_info_def();
+  std::string serialized;
+  if (!tensorflow::SerializeToStringDeterministic(
+          meta_graph_def, &serialized)) {
+    return TRITONTF_ErrorNew(
+        "unable to serialize the graph of '" + std::string(model_path) + "'");
+  }
+  *hash = tensorflow::Hash64(serialized);
   return nullptr;
 }
 
+TRITONTF_Error*
+TRITONTF_ModelRestoreVariables(TRITONTF_Model* model, const char* model_path)
+{
+  ModelImpl* m = reinterpret_cast<ModelImpl*>(model);
+  return m->RestoreVariables(model_path);
+}
+
+void
+TRITONTF_ModelLoadPhases(
+    TRITONTF_Model* model,
+    std::vector<std::pair<std::string, uint64_t>>* phase_usecs)
+{
+  ModelImpl* m = reinterpret_cast<ModelImpl*>(model);
+  *phase_usecs = m->GetLoadPhases();
+}
+
 TRITONTF_Error*
 TRITONTF_LoadAndRegisterLibrary(const char* path)
 {
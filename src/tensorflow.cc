@@ -26,7 +26,11 @@
 
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <limits>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <thread>
 #include <unordered_map>
@@ -39,6 +43,10 @@
 #include "triton/backend/backend_model_instance.h"
 #include "triton/backend/backend_output_responder.h"
 
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif  // __GLIBC__
+
 #ifdef TRITON_ENABLE_GPU
 #include <cuda_runtime_api.h>
 #endif  // TRITON_ENABLE_GPU
@@ -56,12 +64,77 @@ using cudaStream_t = void*;
 using IONameMap = std::unordered_map<std::string, std::string>;
 using TRITONTFModelHandle = std::shared_ptr<TRITONTF_Model>;
 
+// Number of input shape signatures that a CPU model instance keeps to
+// count the runs with new input shapes.
+constexpr size_t kShapeSignatureCacheCapacity = 1024;
+
+// Map from configuration name to tensor name for the inputs and
+// outputs of a signature served by a SavedModel model.
+struct SignatureIONames {
+  IONameMap input_name_map_;
+  IONameMap output_name_map_;
+};
+
+// A SavedModel model that a graph-identical version of the same model
+// can take over by restoring its own variables into the session.
+// 'users_' are the model states using the session, which is only taken
+// over once none of them does: the last of them to be unloaded parks
+// the session in 'parked_model_' for the next version.
+struct RestorableModel {
+  std::string model_name_;
+  int device_id_;
+  uint64_t version_;
+  std::weak_ptr<TRITONTF_Model> tritontf_model_;
+  TRITONTFModelHandle parked_model_;
+  // The time at which 'parked_model_' is released if no version has
+  // taken it over
+  uint64_t park_deadline_ns_;
+  std::set<const void*> users_;
+  int input_device_id_;
+  IONameMap input_name_map_;
+  IONameMap output_name_map_;
+  std::map<std::string, SignatureIONames> signatures_;
+};
+
+// A model that the models loading the same files with the same
+// session options share. 'users_' are the model states using it, a
+// model state doesn't share a model with itself so that its own
+// instances keep the sessions that 'MAX_SESSION_SHARE_COUNT' gives.
+struct SharedModel {
+  std::weak_ptr<TRITONTF_Model> tritontf_model_;
+  std::set<const void*> users_;
+};
+
+// An allocator statistic that is published as a metric
+struct AllocatorMetric {
+  const char* name_;
+  const char* description_;
+  int64_t TRITONTF_AllocatorStats::*stat_;
+};
+
+const AllocatorMetric kAllocatorMetrics[] = {
+    {"nv_tensorflow_allocator_bytes_in_use",
+     "Bytes in use in the TensorFlow allocator of the device",
+     &TRITONTF_AllocatorStats::bytes_in_use_},
+    {"nv_tensorflow_allocator_peak_bytes_in_use",
+     "Peak bytes in use in the TensorFlow allocator of the device",
+     &TRITONTF_AllocatorStats::peak_bytes_in_use_},
+    {"nv_tensorflow_allocator_largest_alloc_bytes",
+     "Largest allocation made by the TensorFlow allocator of the device",
+     &TRITONTF_AllocatorStats::largest_alloc_size_},
+    {"nv_tensorflow_allocator_alloc_count",
+     "Number of allocations made by the TensorFlow allocator of the device",
+     &TRITONTF_AllocatorStats::num_allocs_}};
+
 // BackendConfiguration
 struct BackendConfiguration {
   BackendConfiguration()
       : allow_gpu_memory_growth_(true), per_process_gpu_memory_fraction_(0.0),
         allow_soft_placement_(true), memory_limit_mb_(),
-        default_max_batch_size_(0)
+        default_max_batch_size_(0), huge_page_mode_(HugePageMode::NONE),
+        onednn_(-1), onednn_primitive_cache_capacity_(-1),
+        onednn_native_format_(-1), allocator_metrics_interval_ms_(0),
+        load_phase_metric_family_(nullptr), stop_parked_model_reaper_(false)
   {
   }
   bool allow_gpu_memory_growth_;
@@ -69,6 +142,65 @@ struct BackendConfiguration {
   bool allow_soft_placement_;
   std::map<int, std::vector<float>> memory_limit_mb_;
   int default_max_batch_size_;
+  HugePageMode huge_page_mode_;
+  // oneDNN options, -1 if not set.
+  int onednn_;
+  int onednn_primitive_cache_capacity_;
+  int onednn_native_format_;
+  // The updates of the op lists of the auto mixed precision rewriters,
+  // empty if not set.
+  std::string amp_allow_list_add_;
+  std::string amp_allow_list_remove_;
+  std::string amp_deny_list_add_;
+  std::string amp_deny_list_remove_;
+  // The interval at which the allocator metrics are refreshed, 0 if
+  // they are not published.
+  int allocator_metrics_interval_ms_;
+  // A metric family for each of 'kAllocatorMetrics'
+  std::vector<TRITONSERVER_MetricFamily*> allocator_metric_families_;
+  // The metric family of the model load phase times, nullptr if
+  // metrics are not available.
+  TRITONSERVER_MetricFamily* load_phase_metric_family_;
+
+  // Thread pools that are shared by name across models and instances.
+  // A pool is destroyed once no instance uses it.
+  std::mutex thread_pools_mu_;
+  std::map<std::string, std::weak_ptr<TRITONTF_ThreadPools>> thread_pools_;
+
+  // SavedModel models that variable-only updates can restore into,
+  // keyed by model name, device and graph hash.
+  std::mutex restorable_models_mu_;
+  std::map<std::string, RestorableModel> restorable_models_;
+  // The thread that releases the parked models once their deadline
+  // passes, started when the first model is parked. Guarded by
+  // 'restorable_models_mu_'.
+  std::thread parked_model_thread_;
+  std::condition_variable parked_model_cv_;
+  bool stop_parked_model_reaper_;
+
+  // Models shared across the models that set 'TF_SHARE_SESSION', keyed
+  // by canonical path, content hash, device and session options.
+  std::mutex shared_models_mu_;
+  std::map<std::string, std::vector<SharedModel>> shared_models_;
+};
+
+// Sequence state that is kept by the backend between the requests of
+// a sequence. 'output_name_' is the model output that produces the
+// state of a step and 'input_name_' is the model input that consumes
+// that state on the next step of the same sequence.
+struct SequenceStateConfig {
+  std::string input_name_;
+  std::string output_name_;
+  TRITONSERVER_DataType datatype_;
+  std::vector<int64_t> dims_;
+};
+
+// A ragged input that is padded, instead of flattened, into a batch
+// tensor of the largest request shape of the batch, with each
+// dimension rounded up to a multiple of 'multiple_'.
+struct PaddedInputConfig {
+  double pad_value_;
+  int64_t multiple_;
 };
 
 namespace graphdef {
@@ -109,7 +241,9 @@ ValidateSequenceControl(
 }
 
 TRITONSERVER_Error*
-ValidateTRITONTFModel(BackendModel* model_state, TRITONTF_Model* model)
+ValidateTRITONTFModel(
+    BackendModel* model_state, TRITONTF_Model* model,
+    const std::vector<SequenceStateConfig>& sequence_states)
 {
   const std::string& model_name = model_state->Name();
   triton::common::TritonJson::Value& model_config = model_state->ModelConfig();
@@ -160,6 +294,28 @@ ValidateTRITONTFModel(BackendModel* model_state, TRITONTF_Model* model)
         false /* required */, false /* is_boolean */));
   }
 
+  // Sequence state is fed and fetched by the backend so the model
+  // must provide both ends of each state.
+  for (const auto& state : sequence_states) {
+    if (potential_inputs.find(state.input_name_) == potential_inputs.end()) {
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (std::string("unable to load model '") + model_name +
+           "', sequence state input '" + state.input_name_ +
+           "' is not provided by the model")
+              .c_str());
+    }
+    if (potential_outputs.find(state.output_name_) ==
+        potential_outputs.end()) {
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (std::string("unable to load model '") + model_name +
+           "', sequence state output '" + state.output_name_ +
+           "' is not provided by the model")
+              .c_str());
+    }
+  }
+
   for (size_t i = 0; i < config_inputs.ArraySize(); i++) {
     triton::common::TritonJson::Value io;
     RETURN_IF_ERROR(config_inputs.IndexAsObject(i, &io));
@@ -249,10 +405,17 @@ ValidateSequenceControl(
   return nullptr;  // success
 }
 
+// Validate the signature with 'inputs' and 'outputs' against the model
+// configuration. If 'partial' is true the signature serves only the
+// configuration inputs and outputs it has, which is the case when the
+// model serves more than one signature.
 TRITONSERVER_Error*
 ValidateTRITONTFModel(
-    BackendModel* model_state, TRITONTF_Model* model, IONameMap* input_name_map,
-    IONameMap* output_name_map)
+    BackendModel* model_state, const TRITONTF_IOList* inputs,
+    const TRITONTF_IOList* outputs,
+    const std::vector<SequenceStateConfig>& sequence_states,
+    const std::map<std::string, PaddedInputConfig>& padded_inputs,
+    const bool partial, IONameMap* input_name_map, IONameMap* output_name_map)
 {
   const std::string& model_name = model_state->Name();
   triton::common::TritonJson::Value& model_config = model_state->ModelConfig();
@@ -260,9 +423,6 @@ ValidateTRITONTFModel(
   // The model inputs are the expected inputs and the outputs are
   // the allowed outputs. Saved-model gives these explicitly so we can
   // check precisely if the model configuration matches.
-  const TRITONTF_IOList* inputs = TRITONTF_ModelInputs(model);
-  const TRITONTF_IOList* outputs = TRITONTF_ModelOutputs(model);
-
   std::set<std::string> expected_inputs, allowed_outputs;
   for (const TRITONTF_IOList* itr = inputs; itr != nullptr; itr = itr->next_) {
     expected_inputs.insert(itr->io_->name_);
@@ -275,7 +435,16 @@ ValidateTRITONTFModel(
 
   triton::common::TritonJson::Value config_inputs;
   RETURN_IF_ERROR(model_config.MemberAsArray("input", &config_inputs));
-  size_t expected_input_cnt = config_inputs.ArraySize();
+  size_t expected_input_cnt = 0;
+  for (size_t i = 0; i < config_inputs.ArraySize(); i++) {
+    triton::common::TritonJson::Value io;
+    RETURN_IF_ERROR(config_inputs.IndexAsObject(i, &io));
+    std::string io_name;
+    RETURN_IF_ERROR(io.MemberAsString("name", &io_name));
+    if (!partial || (expected_inputs.find(io_name) != expected_inputs.end())) {
+      expected_input_cnt++;
+    }
+  }
   {
     triton::common::TritonJson::Value config_batch_inputs;
     RETURN_IF_ERROR(
@@ -315,6 +484,44 @@ ValidateTRITONTFModel(
     }
   }
 
+  // Sequence state inputs are not part of the configuration inputs as
+  // they are fed by the backend, but they must match the model.
+  for (const auto& state : sequence_states) {
+    const TRITONTF_IO* input = FindIOByName(inputs, state.input_name_);
+    if (input == nullptr) {
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (std::string("unable to load model '") + model_name +
+           "', sequence state input '" + state.input_name_ +
+           "' is not provided by the model")
+              .c_str());
+    }
+    const TRITONTF_IO* output = FindIOByName(outputs, state.output_name_);
+    if (output == nullptr) {
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (std::string("unable to load model '") + model_name +
+           "', sequence state output '" + state.output_name_ +
+           "' is not provided by the model")
+              .c_str());
+    }
+    if ((ConvertDataType(input->data_type_) != state.datatype_) ||
+        (ConvertDataType(output->data_type_) != state.datatype_)) {
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (std::string("unable to load model '") + model_name +
+           "', sequence state '" + state.input_name_ + "' expects TYPE_" +
+           TRITONSERVER_DataTypeString(state.datatype_) +
+           " but the model provides TYPE_" +
+           TRITONSERVER_DataTypeString(ConvertDataType(input->data_type_)) +
+           " input and TYPE_" +
+           TRITONSERVER_DataTypeString(ConvertDataType(output->data_type_)) +
+           " output")
+              .c_str());
+    }
+    expected_input_cnt += 1;
+  }
+
   // Verify that the model configuration input and outputs match what
   // is expected by the model.
   // Check the name of each input first before checking the count to ensure that
@@ -323,11 +530,14 @@ ValidateTRITONTFModel(
   for (size_t i = 0; i < config_inputs.ArraySize(); i++) {
     triton::common::TritonJson::Value io;
     RETURN_IF_ERROR(config_inputs.IndexAsObject(i, &io));
-    RETURN_IF_ERROR(CheckAllowedModelInput(io, expected_inputs));
 
     std::string io_name;
     RETURN_IF_ERROR(io.MemberAsString("name", &io_name));
     const TRITONTF_IO* input = FindIOByName(inputs, io_name);
+    if (partial && (input == nullptr)) {
+      continue;
+    }
+    RETURN_IF_ERROR(CheckAllowedModelInput(io, expected_inputs));
     if (input == nullptr) {
       return TRITONSERVER_ErrorNew(
           TRITONSERVER_ERROR_INTERNAL,
@@ -352,6 +562,9 @@ ValidateTRITONTFModel(
     std::string io_name;
     RETURN_IF_ERROR(io.MemberAsString("name", &io_name));
     const TRITONTF_IO* input = FindIOByName(inputs, io_name);
+    if (input == nullptr) {
+      continue;
+    }
 
     // If a reshape is provided for the input then use that when
     // validating that the TF model matches what is expected.
@@ -368,7 +581,9 @@ ValidateTRITONTFModel(
       if (io.Find("allow_ragged_batch", &allow_ragged_batch_json)) {
         RETURN_IF_ERROR(allow_ragged_batch_json.AsBool(&allow_ragged_batch));
       }
-      if (allow_ragged_batch) {
+      // A padded ragged input is batched like other inputs
+      if (allow_ragged_batch &&
+          (padded_inputs.find(io_name) == padded_inputs.end())) {
         // Make sure the input has shape [-1]
         if ((input->shape_->rank_ != 1) ||
             (input->shape_->dims_[0] != WILDCARD_DIM)) {
@@ -416,11 +631,14 @@ ValidateTRITONTFModel(
   for (size_t i = 0; i < config_outputs.ArraySize(); i++) {
     triton::common::TritonJson::Value io;
     RETURN_IF_ERROR(config_outputs.IndexAsObject(i, &io));
-    RETURN_IF_ERROR(CheckAllowedModelOutput(io, allowed_outputs));
 
     std::string io_name;
     RETURN_IF_ERROR(io.MemberAsString("name", &io_name));
     const TRITONTF_IO* output = FindIOByName(outputs, io_name);
+    if (partial && (output == nullptr)) {
+      continue;
+    }
+    RETURN_IF_ERROR(CheckAllowedModelOutput(io, allowed_outputs));
     if (output == nullptr) {
       return TRITONSERVER_ErrorNew(
           TRITONSERVER_ERROR_INTERNAL,
@@ -477,8 +695,8 @@ ValidateTRITONTFModel(
 
 // This function will return a tensor's contents as a contiguous
 // chunk in system memory. In some cases this will require copying the data.
-// If that  happens, 'contiguous_buffer' will be set to hold the contiguous
-// chunk and 'cuda_copy' will be set to indicate whether CUDA copy is
+// If that  happens, the contiguous chunk is allocated from 'arena'
+// and 'cuda_copy' will be set to indicate whether CUDA copy is
 // conducted.  The data copy can be avoided if the input is already in
 // a contiguous chunk and the input is located in memory type and id
 // specified.
@@ -486,11 +704,10 @@ TRITONSERVER_Error*
 GetContiguousInputContent(
     TRITONBACKEND_Input* rinput, const char* host_policy_name,
     const uint32_t buffer_count, const char** content,
-    size_t* content_byte_size, char** contiguous_buffer, cudaStream_t stream,
+    size_t* content_byte_size, ScratchArena* arena, cudaStream_t stream,
     bool* cuda_copy)
 {
   *cuda_copy = false;
-  *contiguous_buffer = nullptr;
 
   // Check input buffers to see if data copy is necessary
   size_t chunk_count = 0;
@@ -523,7 +740,15 @@ GetContiguousInputContent(
         rinput, host_policy_name, 0, (const void**)content, content_byte_size,
         &src_memory_type, &src_memory_type_id));
   } else {
-    *contiguous_buffer = (char*)malloc(total_byte_size);
+    char* contiguous_buffer = arena->Allocate(total_byte_size);
+    if (contiguous_buffer == nullptr) {
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INTERNAL,
+          (std::string("failed to allocate ") +
+           std::to_string(total_byte_size) +
+           " bytes for contiguous input content")
+              .c_str());
+    }
 
     size_t offset = 0;
     for (size_t i = 0; i < chunk_count; i++) {
@@ -539,12 +764,12 @@ GetContiguousInputContent(
       RETURN_IF_ERROR(CopyBuffer(
           "Contiguous input", src_memory_type, src_memory_type_id,
           TRITONSERVER_MEMORY_CPU, 0, src_byte_size, src_ptr,
-          *contiguous_buffer + offset, stream, &cuda_used));
+          contiguous_buffer + offset, stream, &cuda_used));
       *cuda_copy |= cuda_used;
       offset += src_byte_size;
     }
 
-    *content = *contiguous_buffer;
+    *content = contiguous_buffer;
     *content_byte_size = total_byte_size;
   }
 
@@ -564,7 +789,7 @@ SetStringInputTensor(
     TRITONTF_Tensor* tensor, TRITONBACKEND_Input* input, const char* name,
     const uint32_t buffer_count, const size_t request_element_cnt,
     const size_t tensor_offset, TRITONBACKEND_Response** response,
-    cudaStream_t stream, const char* host_policy_name)
+    cudaStream_t stream, const char* host_policy_name, ScratchArena* arena)
 {
   bool cuda_copy = false;
 
@@ -575,14 +800,12 @@ SetStringInputTensor(
   const char* content = nullptr;
   size_t content_byte_size = 0;
 
-  char* contiguous_buffer = nullptr;
   auto err = GetContiguousInputContent(
       input, host_policy_name, buffer_count, &content, &content_byte_size,
-      &contiguous_buffer, stream, &cuda_copy);
+      arena, stream, &cuda_copy);
   if (err != nullptr) {
     RESPOND_AND_SET_NULL_IF_ERROR(response, err);
     FillStringTensor(tensor, tensor_offset, request_element_cnt);
-    free(contiguous_buffer);
     return cuda_copy;
   }
 
@@ -593,22 +816,36 @@ SetStringInputTensor(
   }
 #endif  // TRITON_ENABLE_GPU
 
-  std::vector<std::pair<const char*, const uint32_t>> str_list;
-  err = ValidateStringBuffer(
-      content, content_byte_size, request_element_cnt, name, &str_list);
-  // Set string values.
-  for (size_t element_idx = 0; element_idx < str_list.size(); ++element_idx) {
-    const auto& [addr, len] = str_list[element_idx];
-    TRITONTF_TensorSetString(tensor, tensor_offset + element_idx, addr, len);
+  // The start and length of each string are parsed into arrays that
+  // are then set into the tensor with a single call.
+  const char** strs = reinterpret_cast<const char**>(
+      arena->Allocate(request_element_cnt * sizeof(const char*)));
+  size_t* lengths = reinterpret_cast<size_t*>(
+      arena->Allocate(request_element_cnt * sizeof(size_t)));
+  if ((strs == nullptr) || (lengths == nullptr)) {
+    RESPOND_AND_SET_NULL_IF_ERROR(
+        response, TRITONSERVER_ErrorNew(
+                      TRITONSERVER_ERROR_INTERNAL,
+                      (std::string("failed to allocate string index for "
+                                   "input '") +
+                       name + "'")
+                          .c_str()));
+    FillStringTensor(tensor, tensor_offset, request_element_cnt);
+    return cuda_copy;
   }
 
-  size_t element_cnt = str_list.size();
+  size_t element_cnt = 0;
+  err = ParseStringBuffer(
+      content, content_byte_size, request_element_cnt, name, strs, lengths,
+      &element_cnt);
+  // Set string values.
+  TRITONTF_TensorSetStrings(tensor, tensor_offset, element_cnt, strs, lengths);
+
   if (err != nullptr) {
     RESPOND_AND_SET_NULL_IF_ERROR(response, err);
     FillStringTensor(
         tensor, tensor_offset + element_cnt, request_element_cnt - element_cnt);
   }
-  free(contiguous_buffer);
   return cuda_copy;
 }
 
@@ -616,20 +853,40 @@ bool
 SetStringOutputBuffer(
     TRITONTF_Tensor* tensor, TRITONBACKEND_Response** response,
     TRITONBACKEND_Output* response_output, const size_t tensor_element_count,
-    const size_t tensor_offset, cudaStream_t stream, std::string* serialized)
+    const size_t tensor_offset, cudaStream_t stream, ScratchArena* arena)
 {
   bool cuda_copy = false;
 
   // Serialize the output tensor strings. Each string is serialized as
   // a 4-byte length followed by the string itself with no
-  // null-terminator.
-  serialized->clear();
+  // null-terminator. The serialized tensor is staged in 'arena' as it
+  // must be valid until the output copies are done.
+  size_t serialized_byte_size = 0;
+  for (size_t e = 0; e < tensor_element_count; ++e) {
+    size_t len;
+    TRITONTF_TensorString(tensor, tensor_offset + e, &len);
+    serialized_byte_size += sizeof(uint32_t) + len;
+  }
+
+  char* serialized = arena->Allocate(serialized_byte_size);
+  if (serialized == nullptr) {
+    RESPOND_AND_SET_NULL_IF_ERROR(
+        response, TRITONSERVER_ErrorNew(
+                      TRITONSERVER_ERROR_INTERNAL,
+                      "failed to allocate string output staging buffer"));
+    return cuda_copy;
+  }
+
+  size_t offset = 0;
   for (size_t e = 0; e < tensor_element_count; ++e) {
     size_t len;
     const char* cstr = TRITONTF_TensorString(tensor, tensor_offset + e, &len);
-    serialized->append(reinterpret_cast<const char*>(&len), sizeof(uint32_t));
+    const uint32_t len32 = len;
+    memcpy(serialized + offset, &len32, sizeof(uint32_t));
+    offset += sizeof(uint32_t);
     if (len > 0) {
-      serialized->append(cstr, len);
+      memcpy(serialized + offset, cstr, len);
+      offset += len;
     }
   }
 
@@ -639,7 +896,7 @@ SetStringOutputBuffer(
 
   void* buffer;
   auto err = TRITONBACKEND_OutputBuffer(
-      response_output, &buffer, serialized->size(), &actual_memory_type,
+      response_output, &buffer, serialized_byte_size, &actual_memory_type,
       &actual_memory_type_id);
   if (err != nullptr) {
     RESPOND_AND_SET_NULL_IF_ERROR(response, err);
@@ -651,8 +908,8 @@ SetStringOutputBuffer(
   err = CopyBuffer(
       "String output", TRITONSERVER_MEMORY_CPU /* src_memory_type */,
       0 /* src_memory_type_id */, actual_memory_type, actual_memory_type_id,
-      serialized->size(), reinterpret_cast<const void*>(serialized->c_str()),
-      buffer, stream, &cuda_used);
+      serialized_byte_size, reinterpret_cast<const void*>(serialized), buffer,
+      stream, &cuda_used);
   cuda_copy |= cuda_used;
 
   if (err != nullptr) {
@@ -663,6 +920,186 @@ SetStringOutputBuffer(
   return cuda_copy;
 }
 
+// Get the key that identifies the sequence that 'request' belongs
+// to. The correlation ID of a sequence may be an integer or a string.
+TRITONSERVER_Error*
+GetSequenceKey(TRITONBACKEND_Request* request, std::string* key)
+{
+  uint64_t corr_id;
+  auto err = TRITONBACKEND_RequestCorrelationId(request, &corr_id);
+  if (err == nullptr) {
+    *key = std::to_string(corr_id);
+    return nullptr;  // success
+  }
+  TRITONSERVER_ErrorDelete(err);
+
+  const char* corr_id_str;
+  RETURN_IF_ERROR(
+      TRITONBACKEND_RequestCorrelationIdString(request, &corr_id_str));
+  // Prefix string IDs so they never collide with integer IDs.
+  *key = std::string("s:") + corr_id_str;
+  return nullptr;  // success
+}
+
+// Set 'byte_size' bytes of the tensor data, starting at 'offset', to
+// zero. Return true if an asynchronous CUDA operation is issued.
+bool
+ZeroTensorRegion(
+    TRITONTF_Tensor* tensor, const size_t offset, const size_t byte_size,
+    cudaStream_t stream)
+{
+  char* base = TRITONTF_TensorData(tensor) + offset;
+#ifdef TRITON_ENABLE_GPU
+  if (TRITONTF_TensorIsGPUTensor(tensor)) {
+    cudaMemsetAsync(base, 0, byte_size, stream);
+    return true;
+  }
+#endif  // TRITON_ENABLE_GPU
+  memset(base, 0, byte_size);
+  return false;
+}
+
+uint64_t
+SteadyClockNs()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Park 'handle' in 'restorable' until 'timeout_ns' from now, starting
+// the thread that releases the parked models of 'config' if needed.
+// The caller holds 'config->restorable_models_mu_'.
+void
+ParkRestorableModel(
+    BackendConfiguration* config, RestorableModel* restorable,
+    const TRITONTFModelHandle& handle, const uint64_t timeout_ns)
+{
+  restorable->parked_model_ = handle;
+  restorable->park_deadline_ns_ = SteadyClockNs() + timeout_ns;
+  if (config->parked_model_thread_.joinable()) {
+    config->parked_model_cv_.notify_all();
+    return;
+  }
+
+  config->parked_model_thread_ = std::thread([config]() {
+    std::unique_lock<std::mutex> lock(config->restorable_models_mu_);
+    while (!config->stop_parked_model_reaper_) {
+      // Release the parked models whose deadline has passed, outside
+      // of the lock as that deletes their session, and forget the
+      // models that are neither parked nor used.
+      const uint64_t now_ns = SteadyClockNs();
+      uint64_t next_deadline_ns = 0;
+      std::vector<TRITONTFModelHandle> expired;
+      auto& restorable_models = config->restorable_models_;
+      for (auto it = restorable_models.begin();
+           it != restorable_models.end();) {
+        RestorableModel& restorable = it->second;
+        if (restorable.parked_model_ != nullptr) {
+          if (restorable.park_deadline_ns_ <= now_ns) {
+            expired.emplace_back(std::move(restorable.parked_model_));
+          } else if (
+              (next_deadline_ns == 0) ||
+              (restorable.park_deadline_ns_ < next_deadline_ns)) {
+            next_deadline_ns = restorable.park_deadline_ns_;
+          }
+        }
+        if ((restorable.parked_model_ == nullptr) &&
+            restorable.users_.empty()) {
+          it = restorable_models.erase(it);
+        } else {
+          ++it;
+        }
+      }
+      if (!expired.empty()) {
+        lock.unlock();
+        expired.clear();
+        lock.lock();
+        continue;
+      }
+
+      if (next_deadline_ns == 0) {
+        config->parked_model_cv_.wait(lock);
+      } else {
+        config->parked_model_cv_.wait_for(
+            lock, std::chrono::nanoseconds(next_deadline_ns - now_ns));
+      }
+    }
+  });
+}
+
+// Return the free memory at the top of the heap and in the free lists
+// of the allocator to the operating system, where supported.
+void
+TrimHeap()
+{
+#ifdef __GLIBC__
+  malloc_trim(0);
+#endif  // __GLIBC__
+}
+
+// Log the time that each grappler pass has taken since 'before' was
+// captured by TRITONTF_GrapplerPassTimes(). The pass times are
+// process-wide so the logged times also include the passes of other
+// models that are optimized concurrently. Returns the total time in
+// microseconds.
+uint64_t
+LogGrapplerPassTimes(
+    const std::string& what, const std::map<std::string, uint64_t>& before)
+{
+  std::map<std::string, uint64_t> after;
+  TRITONTF_GrapplerPassTimes(&after);
+
+  std::string times;
+  uint64_t total_usecs = 0;
+  for (const auto& pass : after) {
+    auto it = before.find(pass.first);
+    const uint64_t usecs =
+        pass.second - ((it == before.end()) ? 0 : it->second);
+    if (usecs != 0) {
+      times += " " + pass.first + "=" + std::to_string(usecs) + "us";
+      total_usecs += usecs;
+    }
+  }
+  if (total_usecs != 0) {
+    LOG_MESSAGE(
+        TRITONSERVER_LOG_INFO,
+        (std::string("grappler passes for ") + what + " took " +
+         std::to_string(total_usecs) + "us:" + times)
+            .c_str());
+  }
+  return total_usecs;
+}
+
+// Times the phases of a model load.
+class LoadPhaseTimer {
+ public:
+  LoadPhaseTimer() : start_ns_(SteadyClockNs()) {}
+
+  // Record the time since the previous phase ended as phase 'phase'.
+  void EndPhase(const std::string& phase)
+  {
+    const uint64_t now_ns = SteadyClockNs();
+    phases_.emplace_back(phase, (now_ns - start_ns_) / 1000);
+    start_ns_ = now_ns;
+  }
+
+  // Record 'usecs' as phase 'phase' without ending the current phase.
+  void AddPhase(const std::string& phase, const uint64_t usecs)
+  {
+    phases_.emplace_back(phase, usecs);
+  }
+
+  const std::vector<std::pair<std::string, uint64_t>>& Phases() const
+  {
+    return phases_;
+  }
+
+ private:
+  uint64_t start_ns_;
+  std::vector<std::pair<std::string, uint64_t>> phases_;
+};
+
 //
 // ModelState
 //
@@ -689,6 +1126,10 @@ class ModelState : public BackendModel {
     // that output in the model.
     IONameMap output_name_map_;
 
+    // The name maps of the signatures, other than the one the model
+    // was created with, that requests can select.
+    std::map<std::string, SignatureIONames> signatures_;
+
     // The TRITONTFModel handle.
     TRITONTFModelHandle tritontf_model_;
 
@@ -697,24 +1138,134 @@ class ModelState : public BackendModel {
   };
   static TRITONSERVER_Error* Create(
       TRITONBACKEND_Model* triton_model, ModelState** state);
-  virtual ~ModelState() = default;
+  virtual ~ModelState();
 
   BackendConfiguration* BackendConfig() const { return backend_config_; }
   bool IsGraphdef() const { return is_graphdef_; }
+  // Get a model on 'device_id'. 'rebuild' is true if the model replaces
+  // a model that was released with ReleaseModel(), in which case the
+  // session of another version is never taken over.
   TRITONSERVER_Error* GetModel(
-      const int device_id, const std::string& model_path, Model* model);
+      const int device_id, const std::string& model_path, const bool rebuild,
+      Model* model);
+  // Drop the use of 'model', obtained from GetModel() on 'device_id',
+  // so that its session is destroyed once no instance uses it.
+  void ReleaseModel(const int device_id, const Model& model);
   int NumIntraThreads() const { return num_intra_threads_; }
   int NumInterThreads() const { return num_inter_threads_; }
   int UsePerSessionThreads() const { return use_per_session_threads_; }
   const std::string& GraphTag() const { return graph_tag_; }
   const std::string& SignatureDef() const { return signature_def_; }
+  const std::vector<std::string>& SignatureDefs() const
+  {
+    return signature_defs_;
+  }
   const std::string& InitOpsFile() const { return init_ops_file_; }
+  const std::vector<SequenceStateConfig>& SequenceStates() const
+  {
+    return sequence_states_;
+  }
+  uint64_t SequenceIdleTimeoutNs() const { return sequence_idle_timeout_ns_; }
+  // The padded inputs, keyed by input name, and the outputs cropped to
+  // the request shapes of a padded input, keyed by output name.
+  const std::map<std::string, PaddedInputConfig>& PaddedInputs() const
+  {
+    return padded_inputs_;
+  }
+  const std::map<std::string, std::string>& CroppedOutputs() const
+  {
+    return cropped_outputs_;
+  }
+  // The inputs that are broadcast along their first dimension to the
+  // first dimension of another input, keyed by input name.
+  const std::map<std::string, std::string>& BroadcastInputs() const
+  {
+    return broadcast_inputs_;
+  }
+  const std::set<std::string>& ConfigOutputNames() const
+  {
+    return config_output_names_;
+  }
+  int MicroBatchCount() const { return micro_batch_count_; }
+  int MicroBatchMinSize() const { return micro_batch_min_size_; }
+  bool LazySession() const { return lazy_session_; }
+  // The ascending upper bounds of the length buckets that batches are
+  // split into by the length of their ragged inputs, empty if batches
+  // are not split.
+  const std::vector<int64_t>& RaggedLengthBuckets() const
+  {
+    return ragged_length_buckets_;
+  }
+  uint64_t SessionIdleTimeoutNs() const { return session_idle_timeout_ns_; }
+
+  // Call 'check' periodically, with the current steady clock time in
+  // nanoseconds, so that the instance registered under 'key' can
+  // release its session once idle, until the check is unregistered.
+  void RegisterIdleSessionCheck(
+      const void* key, std::function<void(uint64_t)>&& check);
+  void UnregisterIdleSessionCheck(const void* key);
+
+  const std::string& CpuCores() const { return cpu_cores_; }
+  int NumaNode() const { return numa_node_; }
+
+  // The CPU memory budget is enforced on estimates: the CPU bytes a
+  // batch item needs are measured on traced runs, and a run reserves
+  // the estimate of its batch before it starts. A run that doesn't fit
+  // in what is left of the budget is split into sequential
+  // micro-batches, or fails if not even one batch item fits or the
+  // model's batches can't be split.
+  bool HasCpuMemoryBudget() const { return cpu_memory_budget_bytes_ > 0; }
+
+  // Reserve the estimated CPU memory of a run of 'batch_size' items.
+  // 'micro_batch_count' returns the number of sequential micro-batches
+  // the run must be split into, 1 if it fits as a whole,
+  // 'reserved_bytes' the bytes to release with ReleaseCpuMemory once
+  // the run is done and 'trace' whether the run should be traced to
+  // measure its CPU memory.
+  TRITONSERVER_Error* ReserveCpuMemory(
+      const size_t batch_size, int* micro_batch_count,
+      int64_t* reserved_bytes, bool* trace);
+  void ReleaseCpuMemory(const int64_t reserved_bytes);
+
+  // Record that a traced run of 'batch_size' items, of which at most
+  // 'concurrent_items' ran at the same time, allocated 'cpu_bytes'.
+  void RecordCpuMemory(const size_t concurrent_items, const int64_t cpu_bytes);
+
+  // Get the thread pools that 'instance_name' should run with. Returns
+  // nullptr in 'thread_pools' if the session thread pools are used.
+  // The threads of an instance with CPU or NUMA affinity are pinned
+  // to 'cpus' and 'numa_node', such instance always gets its own
+  // thread pools.
+  TRITONSERVER_Error* GetThreadPools(
+      const std::string& instance_name, const std::vector<int>& cpus,
+      const int numa_node, std::shared_ptr<TRITONTF_ThreadPools>* thread_pools);
 
  private:
   TRITONSERVER_Error* CreateModel(
-      const int device_id, const std::string& model_path, Model* model);
+      const int device_id, const std::string& model_path, const bool rebuild,
+      Model* model);
   ModelState(TRITONBACKEND_Model* triton_model);
 
+  // Periodically publish the statistics of the allocators of the
+  // devices that the model sessions use, until the model state is
+  // destroyed.
+  void StartAllocatorMetrics();
+  void RefreshAllocatorMetrics();
+
+  // Run the idle session checks every half of the session idle
+  // timeout, until the model state is destroyed.
+  void StartIdleSessionReaper();
+
+  // Log the time of each phase of a load of the model on 'device_id'
+  // and publish the times as metrics.
+  void ReportLoadPhases(const int device_id, const LoadPhaseTimer& timer);
+
+  // Make the callable of signature 'signature_def' of 'model' from
+  // the name maps of the signature in 'names'.
+  TRITONSERVER_Error* MakeCallable(
+      TRITONTF_Model* model, const std::string& signature_def,
+      const SignatureIONames& names);
+
   // Auto-complete the model configuration
   TRITONSERVER_Error* AutoCompleteConfig();
 
@@ -724,6 +1275,17 @@ class ModelState : public BackendModel {
   // Parses and registers op libraries in config
   TRITONSERVER_Error* ParseAndRegisterLibraries();
 
+  // Parses the sequence states specified by 'TF_SEQUENCE_STATE'
+  TRITONSERVER_Error* ParseSequenceStates(const std::string& spec);
+
+  // Parses the broadcast inputs specified by 'TF_BROADCAST_INPUTS'
+  TRITONSERVER_Error* ParseBroadcastInputs(const std::string& spec);
+
+  // Parses the padded inputs specified by 'TF_PAD_INPUTS' and the
+  // cropped outputs specified by 'TF_CROP_OUTPUTS'
+  TRITONSERVER_Error* ParsePadding(
+      const std::string& pad_spec, const std::string& crop_spec);
+
   // Validate that model configuration is supported by this backend.
   TRITONSERVER_Error* ValidateModelConfig();
 
@@ -737,34 +1299,230 @@ class ModelState : public BackendModel {
   bool use_per_session_threads_;
   std::string graph_tag_;
   std::string signature_def_;
+  std::vector<std::string> signature_defs_;
   std::string init_ops_file_;
+  std::vector<SequenceStateConfig> sequence_states_;
+  uint64_t sequence_idle_timeout_ns_;
+  std::map<std::string, PaddedInputConfig> padded_inputs_;
+  std::map<std::string, std::string> cropped_outputs_;
+  std::map<std::string, std::string> broadcast_inputs_;
+  std::set<std::string> config_output_names_;
+  int micro_batch_count_;
+  int micro_batch_min_size_;
+  bool can_split_batch_;
+  std::string thread_pool_name_;
+  int thread_pool_num_intra_threads_;
+  int thread_pool_num_inter_threads_;
+  bool thread_pool_per_instance_;
+  std::string cpu_cores_;
+  int numa_node_;
+  bool has_grappler_config_;
+  TRITONTF_GrapplerConfig grappler_config_;
+  bool prune_graph_;
+  bool freeze_variables_;
+  bool variable_only_update_;
+  uint64_t parked_session_timeout_ns_;
+  bool share_session_;
+  int64_t cpu_memory_budget_bytes_;
+  std::mutex cpu_memory_mu_;
+  int64_t cpu_memory_reserved_bytes_;
+  int64_t cpu_bytes_per_item_;
+  size_t cpu_memory_traced_batch_size_;
+  bool lazy_session_;
+  uint64_t session_idle_timeout_ns_;
+  std::vector<int64_t> ragged_length_buckets_;
+
+  // Guards 'models_', which instances that create their session on
+  // demand update while the allocator metrics thread reads it.
+  std::mutex models_mu_;
+  std::thread allocator_metrics_thread_;
+  std::mutex allocator_metrics_mu_;
+  std::condition_variable allocator_metrics_cv_;
+  bool stop_allocator_metrics_;
+  // The metrics of each device, in the order of 'kAllocatorMetrics'
+  std::map<std::string, std::vector<TRITONSERVER_Metric*>> allocator_metrics_;
+  // The load phase metrics keyed by device and phase
+  std::mutex load_phase_metrics_mu_;
+  std::map<std::pair<int, std::string>, TRITONSERVER_Metric*>
+      load_phase_metrics_;
+  // The idle session checks of the instances, keyed by instance
+  std::thread idle_session_thread_;
+  std::mutex idle_session_mu_;
+  std::condition_variable idle_session_cv_;
+  bool stop_idle_session_reaper_;
+  std::map<const void*, std::function<void(uint64_t)>> idle_session_checks_;
 };
 
 TRITONSERVER_Error*
-ModelState::GetModel(int device_id, const std::string& model_path, Model* model)
+ModelState::GetModel(
+    int device_id, const std::string& model_path, const bool rebuild,
+    Model* model)
 {
   // reuse existing model if it has been created on the device
-  auto it = models_.find(device_id);
-  if ((it != models_.end()) &&
-      (it->second.first < (size_t)max_session_share_count_)) {
-    *model = it->second.second;
-    ++it->second.first;
-    return nullptr;  // success
+  {
+    std::lock_guard<std::mutex> lock(models_mu_);
+    auto it = models_.find(device_id);
+    if ((it != models_.end()) &&
+        (it->second.first < (size_t)max_session_share_count_)) {
+      *model = it->second.second;
+      ++it->second.first;
+      return nullptr;  // success
+    }
   }
 
-  RETURN_IF_ERROR(CreateModel(device_id, model_path, model));
+  RETURN_IF_ERROR(CreateModel(device_id, model_path, rebuild, model));
+  std::lock_guard<std::mutex> lock(models_mu_);
   models_[device_id] = std::make_pair(1, *model);
   return nullptr;  // success
 }
 
+void
+ModelState::ReleaseModel(const int device_id, const Model& model)
+{
+  // A model that has since been replaced on the device is only held by
+  // the instances that still use it.
+  {
+    std::lock_guard<std::mutex> lock(models_mu_);
+    auto it = models_.find(device_id);
+    if ((it == models_.end()) ||
+        (it->second.second.tritontf_model_ != model.tritontf_model_) ||
+        (--it->second.first != 0)) {
+      return;
+    }
+    models_.erase(it);
+  }
+
+  // The model state no longer uses a session that it shares, so that
+  // the session can be shared with it again when it is rebuilt.
+  if (share_session_) {
+    std::lock_guard<std::mutex> lock(backend_config_->shared_models_mu_);
+    for (auto& shared : backend_config_->shared_models_) {
+      for (auto& entry : shared.second) {
+        if (entry.tritontf_model_.lock() == model.tritontf_model_) {
+          entry.users_.erase(this);
+        }
+      }
+    }
+  }
+}
+
+void
+ModelState::RegisterIdleSessionCheck(
+    const void* key, std::function<void(uint64_t)>&& check)
+{
+  std::lock_guard<std::mutex> lock(idle_session_mu_);
+  idle_session_checks_[key] = std::move(check);
+}
+
+void
+ModelState::UnregisterIdleSessionCheck(const void* key)
+{
+  // Holding the lock also waits for a running check of 'key'.
+  std::lock_guard<std::mutex> lock(idle_session_mu_);
+  idle_session_checks_.erase(key);
+}
+
+void
+ModelState::StartIdleSessionReaper()
+{
+  idle_session_thread_ = std::thread([this]() {
+    const auto interval = std::chrono::nanoseconds(
+        std::max<uint64_t>(session_idle_timeout_ns_ / 2, 1000000));
+    std::unique_lock<std::mutex> lock(idle_session_mu_);
+    while (!idle_session_cv_.wait_for(
+        lock, interval, [this]() { return stop_idle_session_reaper_; })) {
+      const uint64_t now_ns = SteadyClockNs();
+      for (const auto& check : idle_session_checks_) {
+        check.second(now_ns);
+      }
+    }
+  });
+}
+
+TRITONSERVER_Error*
+ModelState::MakeCallable(
+    TRITONTF_Model* model, const std::string& signature_def,
+    const SignatureIONames& names)
+{
+  // When the model serves more than one signature a signature only
+  // feeds and fetches the configuration inputs and outputs it has.
+  const bool partial = !SignatureDefs().empty();
+  std::vector<const char*> input_names, output_names;
+  std::vector<TRITONTF_DataType> input_types, output_types;
+  std::deque<std::string> io_names;
+
+  triton::common::TritonJson::Value config_inputs;
+  RETURN_IF_ERROR(ModelConfig().MemberAsArray("input", &config_inputs));
+  for (size_t i = 0; i < config_inputs.ArraySize(); i++) {
+    triton::common::TritonJson::Value io;
+    RETURN_IF_ERROR(config_inputs.IndexAsObject(i, &io));
+    io_names.emplace_back();
+    RETURN_IF_ERROR(io.MemberAsString("name", &io_names.back()));
+    std::string io_data_type;
+    RETURN_IF_ERROR(io.MemberAsString("data_type", &io_data_type));
+
+    const auto& itr = names.input_name_map_.find(io_names.back());
+    if (partial && (itr == names.input_name_map_.end())) {
+      continue;
+    }
+    input_names.push_back(
+        itr != names.input_name_map_.end() ? itr->second.c_str()
+                                           : io_names.back().c_str());
+    input_types.push_back(ConvertDataType(io_data_type));
+  }
+  triton::common::TritonJson::Value config_outputs;
+  RETURN_IF_ERROR(ModelConfig().MemberAsArray("output", &config_outputs));
+  for (size_t i = 0; i < config_outputs.ArraySize(); i++) {
+    triton::common::TritonJson::Value io;
+    RETURN_IF_ERROR(config_outputs.IndexAsObject(i, &io));
+    io_names.emplace_back();
+    RETURN_IF_ERROR(io.MemberAsString("name", &io_names.back()));
+    std::string io_data_type;
+    RETURN_IF_ERROR(io.MemberAsString("data_type", &io_data_type));
+
+    const auto& itr = names.output_name_map_.find(io_names.back());
+    if (partial && (itr == names.output_name_map_.end())) {
+      continue;
+    }
+    output_names.push_back(
+        itr != names.output_name_map_.end() ? itr->second.c_str()
+                                            : io_names.back().c_str());
+    output_types.push_back(ConvertDataType(io_data_type));
+  }
+
+  // Sequence states are fed and fetched by the backend on every run.
+  for (const auto& state : sequence_states_) {
+    const auto& iitr = names.input_name_map_.find(state.input_name_);
+    input_names.push_back(
+        iitr != names.input_name_map_.end() ? iitr->second.c_str()
+                                            : state.input_name_.c_str());
+    input_types.push_back(ConvertDataType(state.datatype_));
+    const auto& oitr = names.output_name_map_.find(state.output_name_);
+    output_names.push_back(
+        oitr != names.output_name_map_.end() ? oitr->second.c_str()
+                                             : state.output_name_.c_str());
+    output_types.push_back(ConvertDataType(state.datatype_));
+  }
+
+  RETURN_IF_TRITONTF_ERROR(TRITONTF_ModelMakeCallable(
+      model, input_names.data(), input_types.data(), input_names.size(),
+      output_names.data(), output_types.data(), output_names.size(),
+      signature_def.c_str()));
+
+  return nullptr;
+}
+
 TRITONSERVER_Error*
 ModelState::CreateModel(
-    int device_id, const std::string& model_path, Model* model)
+    int device_id, const std::string& model_path, const bool rebuild,
+    Model* model)
 {
+  LoadPhaseTimer timer;
   Model lmodel;
   TRITONTF_TFTRTConfig* tftrt_config_ptr = nullptr;
   TRITONTF_TFTRTConfig tftrt_config;
   bool auto_mixed_precision = false;
+  bool cpu_auto_mixed_precision = false;
   bool has_graph_level = false;
   int64_t graph_level = 0;
   {
@@ -787,13 +1545,50 @@ ModelState::CreateModel(
         tftrt_config.precision_mode_ = TRITONTF_MODE_FP32;
         tftrt_config.is_dynamic_op_ = true;
 
+        // Only the oneDNN bfloat16 auto mixed precision is supported as
+        // CPU Execution Accelerator. The rewriter only affects the nodes
+        // placed on CPU so it is applied regardless of the instance kind.
         triton::common::TritonJson::Value cpu_eas;
-        RETURN_ERROR_IF_TRUE(
-            eas.Find("cpu_execution_accelerator", &cpu_eas) &&
-                (cpu_eas.ArraySize() != 0),
-            TRITONSERVER_ERROR_INVALID_ARG,
-            std::string("CPU Execution Accelerator is not supported in "
-                        "TensorFlow backend"));
+        if (eas.Find("cpu_execution_accelerator", &cpu_eas)) {
+          for (size_t ea_idx = 0; ea_idx < cpu_eas.ArraySize(); ea_idx++) {
+            triton::common::TritonJson::Value ea;
+            RETURN_IF_ERROR(cpu_eas.IndexAsObject(ea_idx, &ea));
+            std::string name;
+            RETURN_IF_ERROR(ea.MemberAsString("name", &name));
+            if (name != kAutoMixedPrecisionExecutionAccelerator) {
+              return TRITONSERVER_ErrorNew(
+                  TRITONSERVER_ERROR_INVALID_ARG,
+                  (std::string("unknown CPU Execution Accelerator '") + name +
+                   "' is requested")
+                      .c_str());
+            }
+
+            // The op lists of the rewriter are process-wide, so they are
+            // backend options rather than parameters of each model.
+            triton::common::TritonJson::Value params;
+            if (ea.Find("parameters", &params)) {
+              std::vector<std::string> param_keys;
+              RETURN_IF_ERROR(params.Members(&param_keys));
+              if (!param_keys.empty()) {
+                return TRITONSERVER_ErrorNew(
+                    TRITONSERVER_ERROR_INVALID_ARG,
+                    std::string(
+                        "unknown parameter '" + param_keys[0] +
+                        "' is provided for CPU auto mixed precision "
+                        "Execution Accelerator, the op lists are set with "
+                        "--backend-config")
+                        .c_str());
+              }
+            }
+            cpu_auto_mixed_precision = true;
+            LOG_MESSAGE(
+                TRITONSERVER_LOG_VERBOSE,
+                (std::string("CPU auto mixed precision Execution Accelerator "
+                             "is set for ") +
+                 Name())
+                    .c_str());
+          }
+        }
 
         // GPU Execution Accelerator is disabled on CPU devices.
         if (device_id == ModelState::NO_GPU_DEVICE) {
@@ -891,80 +1686,8 @@ ModelState::CreateModel(
         "Auto mixed precision can not be set with TFTRT optimization");
   }
 
-  if (IsGraphdef()) {
-    TRITONTF_Model* model = nullptr;
-    RETURN_IF_TRITONTF_ERROR(TRITONTF_ModelCreateFromGraphDef(
-        &model, Name().c_str(), model_path.c_str(), device_id,
-        NumIntraThreads(), NumInterThreads(), UsePerSessionThreads(),
-        has_graph_level, graph_level, BackendConfig()->allow_gpu_memory_growth_,
-        BackendConfig()->per_process_gpu_memory_fraction_,
-        BackendConfig()->allow_soft_placement_,
-        BackendConfig()->memory_limit_mb_, tftrt_config_ptr,
-        auto_mixed_precision));
-    lmodel.tritontf_model_.reset(model, TRITONTF_ModelDelete);
-
-    RETURN_IF_ERROR(graphdef::ValidateTRITONTFModel(this, model));
-  } else {
-    TRITONTF_Model* model = nullptr;
-    RETURN_IF_TRITONTF_ERROR(TRITONTF_ModelCreateFromSavedModel(
-        &model, Name().c_str(), model_path.c_str(), device_id,
-        NumIntraThreads(), NumInterThreads(), UsePerSessionThreads(),
-        GraphTag().c_str(), SignatureDef().c_str(), has_graph_level,
-        graph_level, BackendConfig()->allow_gpu_memory_growth_,
-        BackendConfig()->per_process_gpu_memory_fraction_,
-        BackendConfig()->allow_soft_placement_,
-        BackendConfig()->memory_limit_mb_, tftrt_config_ptr,
-        auto_mixed_precision));
-    lmodel.tritontf_model_.reset(model, TRITONTF_ModelDelete);
-
-    RETURN_IF_ERROR(savedmodel::ValidateTRITONTFModel(
-        this, model, &(lmodel.input_name_map_), &(lmodel.output_name_map_)));
-  }
-
-  if (lmodel.input_device_id_ != ModelState::MODEL_DEVICE) {
-    std::vector<const char*> input_names, output_names;
-    std::vector<TRITONTF_DataType> input_types, output_types;
-    std::deque<std::string> io_names;
-
-    triton::common::TritonJson::Value config_inputs;
-    RETURN_IF_ERROR(ModelConfig().MemberAsArray("input", &config_inputs));
-    for (size_t i = 0; i < config_inputs.ArraySize(); i++) {
-      triton::common::TritonJson::Value io;
-      RETURN_IF_ERROR(config_inputs.IndexAsObject(i, &io));
-      io_names.emplace_back();
-      RETURN_IF_ERROR(io.MemberAsString("name", &io_names.back()));
-      std::string io_data_type;
-      RETURN_IF_ERROR(io.MemberAsString("data_type", &io_data_type));
-
-      const auto& itr = lmodel.input_name_map_.find(io_names.back());
-      input_names.push_back(
-          itr != lmodel.input_name_map_.end() ? itr->second.c_str()
-                                              : io_names.back().c_str());
-      input_types.push_back(ConvertDataType(io_data_type));
-    }
-    triton::common::TritonJson::Value config_outputs;
-    RETURN_IF_ERROR(ModelConfig().MemberAsArray("output", &config_outputs));
-    for (size_t i = 0; i < config_outputs.ArraySize(); i++) {
-      triton::common::TritonJson::Value io;
-      RETURN_IF_ERROR(config_outputs.IndexAsObject(i, &io));
-      io_names.emplace_back();
-      RETURN_IF_ERROR(io.MemberAsString("name", &io_names.back()));
-      std::string io_data_type;
-      RETURN_IF_ERROR(io.MemberAsString("data_type", &io_data_type));
-
-      const auto& itr = lmodel.output_name_map_.find(io_names.back());
-      output_names.push_back(
-          itr != lmodel.output_name_map_.end() ? itr->second.c_str()
-                                               : io_names.back().c_str());
-      output_types.push_back(ConvertDataType(io_data_type));
-    }
-
-    RETURN_IF_TRITONTF_ERROR(TRITONTF_ModelMakeCallable(
-        lmodel.tritontf_model_.get(), input_names.data(), input_types.data(),
-        config_inputs.ArraySize(), output_names.data(), output_types.data(),
-        config_outputs.ArraySize()));
-  }
-
+  std::vector<const char*> init_ops;
+  std::deque<std::string> init_ops_str;
   if (!init_ops_file_.empty()) {
     std::string init_ops_path;
     // We first check whether the file exists in the model version folder. If it
@@ -982,8 +1705,6 @@ ModelState::CreateModel(
     RETURN_IF_ERROR(ReadTextFile(init_ops_path, &json_contents));
     triton::common::TritonJson::Value init_ops_json;
     RETURN_IF_ERROR(init_ops_json.Parse(json_contents));
-    std::vector<const char*> init_ops;
-    std::deque<std::string> init_ops_str;
 
     triton::common::TritonJson::Value init_ops_array;
     RETURN_IF_ERROR(init_ops_json.MemberAsArray("init_ops", &init_ops_array));
@@ -992,18 +1713,419 @@ ModelState::CreateModel(
       RETURN_IF_ERROR(init_ops_array.IndexAsString(i, &init_ops_str.back()));
       init_ops.push_back(init_ops_str.back().c_str());
     }
-    RETURN_IF_TRITONTF_ERROR(TRITONTF_ModelInitialize(
-        lmodel.tritontf_model_.get(), init_ops.size(), init_ops.data()));
   }
-  *model = std::move(lmodel);
-  return nullptr;
-}
 
-TRITONSERVER_Error*
-ModelState::Create(TRITONBACKEND_Model* triton_model, ModelState** state)
-{
-  try {
-    *state = new ModelState(triton_model);
+  // A version whose graph matches an unloaded version of the model only
+  // differs in its variables and assets, so it takes over the parked
+  // session of that version, restores its own variables into it and
+  // runs the init ops again. This skips the session creation and graph
+  // optimization. The session of a version that is still loaded is
+  // never taken over, as that version keeps serving from it, so this
+  // only applies when the old version was unloaded before this one
+  // loads. A rebuilt session is always created anew.
+  std::string restorable_key;
+  if (variable_only_update_) {
+    uint64_t graph_hash;
+    RETURN_IF_TRITONTF_ERROR(TRITONTF_SavedModelGraphHash(
+        model_path.c_str(), GraphTag().c_str(), &graph_hash));
+    restorable_key = Name() + ":" + std::to_string(device_id) + ":" +
+                     std::to_string(graph_hash);
+
+    RestorableModel restorable;
+    {
+      std::lock_guard<std::mutex> lock(BackendConfig()->restorable_models_mu_);
+      auto& restorable_models = BackendConfig()->restorable_models_;
+      auto it = restorable_models.find(restorable_key);
+      if (!rebuild && (it != restorable_models.end()) &&
+          it->second.users_.empty() && (it->second.version_ != Version())) {
+        restorable = it->second;
+        it->second.parked_model_.reset();
+        it->second.users_.insert(this);
+        it->second.version_ = Version();
+      }
+      // The parked sessions of other graphs of the model are superseded
+      // by this version.
+      for (auto& entry : restorable_models) {
+        if ((entry.first != restorable_key) &&
+            (entry.second.model_name_ == Name()) &&
+            (entry.second.device_id_ == device_id)) {
+          entry.second.parked_model_.reset();
+        }
+      }
+    }
+    TRITONTFModelHandle handle = std::move(restorable.parked_model_);
+    if (handle != nullptr) {
+      TRITONTF_Error* tf_err =
+          TRITONTF_ModelRestoreVariables(handle.get(), model_path.c_str());
+      if ((tf_err == nullptr) && !init_ops.empty()) {
+        std::vector<std::pair<std::string, uint64_t>> init_op_usecs;
+        tf_err = TRITONTF_ModelInitialize(
+            handle.get(), init_ops.size(), init_ops.data(), &init_op_usecs);
+      }
+      if (tf_err == nullptr) {
+        lmodel.tritontf_model_ = handle;
+        lmodel.input_device_id_ = restorable.input_device_id_;
+        lmodel.input_name_map_ = restorable.input_name_map_;
+        lmodel.output_name_map_ = restorable.output_name_map_;
+        lmodel.signatures_ = restorable.signatures_;
+        LOG_MESSAGE(
+            TRITONSERVER_LOG_INFO,
+            (std::string("restored the variables of version ") +
+             std::to_string(Version()) + " of model '" + Name() +
+             "' into the session of an unloaded graph-identical version")
+                .c_str());
+        timer.EndPhase("restore_variables");
+        ReportLoadPhases(device_id, timer);
+        *model = std::move(lmodel);
+        return nullptr;
+      }
+      LOG_MESSAGE(
+          TRITONSERVER_LOG_WARN,
+          (std::string("unable to restore the variables of version ") +
+           std::to_string(Version()) + " of model '" + Name() +
+           "' into an existing session, creating a new session: " +
+           tf_err->msg_)
+              .c_str());
+      TRITONTF_ErrorDelete(tf_err);
+    }
+  }
+
+  // A model that shares sessions reuses the model that another model
+  // has loaded from the same files with the same session options. The
+  // configuration inputs and outputs are part of the key when they are
+  // compiled into the session, by pruning or by the GPU I/O callables.
+  std::string shared_key;
+  TRITONTFModelHandle shared_handle;
+  if (share_session_) {
+    std::string canonical_path;
+    uint64_t content_hash;
+    RETURN_IF_ERROR(
+        HashModelFiles(model_path, &canonical_path, &content_hash));
+    timer.EndPhase("hash_model_files");
+    std::string key = canonical_path + ";" + std::to_string(content_hash) +
+                      ";" + std::to_string(device_id) + ";" +
+                      std::to_string(lmodel.input_device_id_) + ";" +
+                      std::to_string(NumIntraThreads()) + ";" +
+                      std::to_string(NumInterThreads()) + ";" +
+                      std::to_string(UsePerSessionThreads()) + ";" +
+                      std::to_string(MicroBatchCount()) + ";" + GraphTag() +
+                      ";" + SignatureDef() + ";";
+    for (const auto& signature_def : SignatureDefs()) {
+      key += signature_def + ",";
+    }
+    key += ";" + (has_graph_level ? std::to_string(graph_level) : "") + ";";
+    if (tftrt_config_ptr != nullptr) {
+      key += std::to_string((int)tftrt_config.precision_mode_) + "," +
+             std::to_string(tftrt_config.minimum_segment_size_) + "," +
+             std::to_string(tftrt_config.max_workspace_size_bytes_) + "," +
+             std::to_string(tftrt_config.max_cached_engines_) + "," +
+             std::to_string(tftrt_config.max_batch_size_) + "," +
+             std::to_string(tftrt_config.is_dynamic_op_);
+    }
+    key += ";" + std::to_string(auto_mixed_precision) + ";" +
+           std::to_string(cpu_auto_mixed_precision) + ";";
+    if (has_grappler_config_) {
+      for (const int value :
+           {(int)grappler_config_.remapping_,
+            (int)grappler_config_.arithmetic_optimization_,
+            (int)grappler_config_.dependency_optimization_,
+            (int)grappler_config_.loop_optimization_,
+            (int)grappler_config_.memory_optimization_,
+            (int)grappler_config_.model_pruning_,
+            grappler_config_.meta_optimizer_iterations_}) {
+        key += std::to_string(value) + ",";
+      }
+    }
+    key += ";" + std::to_string(prune_graph_) + ";" +
+           std::to_string(freeze_variables_) + ";";
+    for (const auto& init_op : init_ops_str) {
+      key += init_op + ",";
+    }
+    key += ";";
+    if (prune_graph_ || (lmodel.input_device_id_ != ModelState::MODEL_DEVICE)) {
+      for (const char* io_kind : {"input", "output"}) {
+        triton::common::TritonJson::Value ios;
+        RETURN_IF_ERROR(ModelConfig().MemberAsArray(io_kind, &ios));
+        for (size_t i = 0; i < ios.ArraySize(); i++) {
+          triton::common::TritonJson::Value io;
+          RETURN_IF_ERROR(ios.IndexAsObject(i, &io));
+          std::string io_name, io_data_type;
+          RETURN_IF_ERROR(io.MemberAsString("name", &io_name));
+          RETURN_IF_ERROR(io.MemberAsString("data_type", &io_data_type));
+          key += io_name + ":" + io_data_type + ",";
+        }
+        key += ";";
+      }
+      for (const auto& batch_input : BatchInputs()) {
+        for (const auto& name : batch_input.TargetNames()) {
+          key += name + ",";
+        }
+      }
+      key += ";";
+      for (const auto& state : sequence_states_) {
+        key += state.input_name_ + ":" + state.output_name_ + ",";
+      }
+    }
+    shared_key = std::move(key);
+
+    std::lock_guard<std::mutex> lock(BackendConfig()->shared_models_mu_);
+    auto& entries = BackendConfig()->shared_models_[shared_key];
+    for (auto it = entries.begin(); it != entries.end();) {
+      if (it->tritontf_model_.expired()) {
+        it = entries.erase(it);
+      } else if (
+          (shared_handle == nullptr) && (it->users_.count(this) == 0)) {
+        shared_handle = it->tritontf_model_.lock();
+        it->users_.insert(this);
+        ++it;
+      } else {
+        ++it;
+      }
+    }
+    if (shared_handle != nullptr) {
+      LOG_MESSAGE(
+          TRITONSERVER_LOG_INFO,
+          (std::string("sharing the TensorFlow session of identical model "
+                       "files for model '") +
+           Name() + "' on device " + std::to_string(device_id))
+              .c_str());
+    }
+  }
+
+  std::map<std::string, uint64_t> grappler_pass_usecs;
+  TRITONTF_GrapplerPassTimes(&grappler_pass_usecs);
+
+  // The model creation reports its own phases, which are recorded as
+  // parts of the 'create_model' phase.
+  auto end_create_phase = [&timer](TRITONTF_Model* model) {
+    timer.EndPhase("create_model");
+    std::vector<std::pair<std::string, uint64_t>> create_phases;
+    TRITONTF_ModelLoadPhases(model, &create_phases);
+    for (const auto& phase : create_phases) {
+      timer.AddPhase("create_model/" + phase.first, phase.second);
+    }
+  };
+
+  if (IsGraphdef()) {
+    // The pruned graph keeps every node that the model inputs, outputs,
+    // sequence states and init ops need.
+    std::vector<const char*> keep_nodes;
+    std::deque<std::string> keep_node_names;
+    if (prune_graph_) {
+      for (const char* io_kind : {"input", "output"}) {
+        triton::common::TritonJson::Value ios;
+        if (!ModelConfig().Find(io_kind, &ios)) {
+          continue;
+        }
+        for (size_t i = 0; i < ios.ArraySize(); i++) {
+          triton::common::TritonJson::Value io;
+          RETURN_IF_ERROR(ios.IndexAsObject(i, &io));
+          keep_node_names.emplace_back();
+          RETURN_IF_ERROR(io.MemberAsString("name", &keep_node_names.back()));
+        }
+      }
+      for (const auto& batch_input : BatchInputs()) {
+        for (const auto& name : batch_input.TargetNames()) {
+          keep_node_names.emplace_back(name);
+        }
+      }
+      for (const auto& state : sequence_states_) {
+        keep_node_names.emplace_back(state.input_name_);
+        keep_node_names.emplace_back(state.output_name_);
+      }
+      for (const auto& name : keep_node_names) {
+        keep_nodes.push_back(name.c_str());
+      }
+      keep_nodes.insert(keep_nodes.end(), init_ops.begin(), init_ops.end());
+    }
+
+    TRITONTF_Model* model = shared_handle.get();
+    if (model == nullptr) {
+      RETURN_IF_TRITONTF_ERROR(TRITONTF_ModelCreateFromGraphDef(
+          &model, Name().c_str(), model_path.c_str(), device_id,
+          NumIntraThreads(), NumInterThreads(), UsePerSessionThreads(),
+          has_graph_level, graph_level,
+          BackendConfig()->allow_gpu_memory_growth_,
+          BackendConfig()->per_process_gpu_memory_fraction_,
+          BackendConfig()->allow_soft_placement_,
+          BackendConfig()->memory_limit_mb_, tftrt_config_ptr,
+          auto_mixed_precision, cpu_auto_mixed_precision,
+          has_grappler_config_ ? &grappler_config_ : nullptr,
+          keep_nodes.data(), keep_nodes.size(), !init_ops.empty()));
+      lmodel.tritontf_model_.reset(model, TRITONTF_ModelDelete);
+      end_create_phase(model);
+    } else {
+      lmodel.tritontf_model_ = shared_handle;
+    }
+
+    RETURN_IF_ERROR(
+        graphdef::ValidateTRITONTFModel(this, model, sequence_states_));
+  } else {
+    TRITONTF_Model* model = shared_handle.get();
+    if (model == nullptr) {
+      RETURN_IF_TRITONTF_ERROR(TRITONTF_ModelCreateFromSavedModel(
+          &model, Name().c_str(), model_path.c_str(), device_id,
+          NumIntraThreads(), NumInterThreads(), UsePerSessionThreads(),
+          GraphTag().c_str(), SignatureDef().c_str(), has_graph_level,
+          graph_level, BackendConfig()->allow_gpu_memory_growth_,
+          BackendConfig()->per_process_gpu_memory_fraction_,
+          BackendConfig()->allow_soft_placement_,
+          BackendConfig()->memory_limit_mb_, tftrt_config_ptr,
+          auto_mixed_precision, cpu_auto_mixed_precision,
+          has_grappler_config_ ? &grappler_config_ : nullptr,
+          freeze_variables_));
+      lmodel.tritontf_model_.reset(model, TRITONTF_ModelDelete);
+      end_create_phase(model);
+    } else {
+      lmodel.tritontf_model_ = shared_handle;
+    }
+
+    const bool partial = !SignatureDefs().empty();
+    RETURN_IF_ERROR(savedmodel::ValidateTRITONTFModel(
+        this, TRITONTF_ModelInputs(model), TRITONTF_ModelOutputs(model),
+        sequence_states_, padded_inputs_, partial, &(lmodel.input_name_map_),
+        &(lmodel.output_name_map_)));
+    for (const auto& signature_def : SignatureDefs()) {
+      TRITONTF_IOList* inputs = nullptr;
+      TRITONTF_IOList* outputs = nullptr;
+      RETURN_IF_TRITONTF_ERROR(TRITONTF_ModelSignatureIO(
+          model, signature_def.c_str(), &inputs, &outputs));
+      auto& names = lmodel.signatures_[signature_def];
+      RETURN_IF_ERROR(savedmodel::ValidateTRITONTFModel(
+          this, inputs, outputs, sequence_states_, padded_inputs_, partial,
+          &names.input_name_map_, &names.output_name_map_));
+    }
+
+    // Each configuration input and output must be served by one of
+    // the signatures.
+    if (partial) {
+      for (const char* io_kind : {"input", "output"}) {
+        triton::common::TritonJson::Value config_ios;
+        RETURN_IF_ERROR(ModelConfig().MemberAsArray(io_kind, &config_ios));
+        for (size_t i = 0; i < config_ios.ArraySize(); i++) {
+          triton::common::TritonJson::Value io;
+          RETURN_IF_ERROR(config_ios.IndexAsObject(i, &io));
+          std::string io_name;
+          RETURN_IF_ERROR(io.MemberAsString("name", &io_name));
+          const bool is_input = (strcmp(io_kind, "input") == 0);
+          bool found =
+              is_input ? (lmodel.input_name_map_.count(io_name) != 0)
+                       : (lmodel.output_name_map_.count(io_name) != 0);
+          for (const auto& signature : lmodel.signatures_) {
+            found |= is_input ? (signature.second.input_name_map_.count(
+                                     io_name) != 0)
+                              : (signature.second.output_name_map_.count(
+                                     io_name) != 0);
+          }
+          if (!found) {
+            return TRITONSERVER_ErrorNew(
+                TRITONSERVER_ERROR_INVALID_ARG,
+                (std::string("unable to load model '") + Name() + "', " +
+                 io_kind + " '" + io_name +
+                 "' is not provided by any of the signatures")
+                    .c_str());
+          }
+        }
+      }
+    }
+  }
+
+  timer.EndPhase("validate");
+
+  // The callables, init ops and graph optimization of a shared model
+  // are done by the model that loaded it.
+  if (shared_handle != nullptr) {
+    ReportLoadPhases(device_id, timer);
+    *model = std::move(lmodel);
+    return nullptr;
+  }
+
+  if (lmodel.input_device_id_ != ModelState::MODEL_DEVICE) {
+    // The signature the model was created with and each of the other
+    // signatures get their own callable, which feeds and fetches only
+    // the configuration inputs and outputs the signature has.
+    std::vector<std::pair<std::string, const SignatureIONames*>> signatures;
+    const SignatureIONames primary_names{
+        lmodel.input_name_map_, lmodel.output_name_map_};
+    signatures.emplace_back("", &primary_names);
+    for (const auto& signature : lmodel.signatures_) {
+      signatures.emplace_back(signature.first, &signature.second);
+    }
+    for (const auto& signature : signatures) {
+      RETURN_IF_ERROR(MakeCallable(
+          lmodel.tritontf_model_.get(), signature.first, *signature.second));
+    }
+    timer.EndPhase("make_callable");
+  }
+
+  if (!init_ops.empty()) {
+    std::vector<std::pair<std::string, uint64_t>> init_op_usecs;
+    RETURN_IF_TRITONTF_ERROR(TRITONTF_ModelInitialize(
+        lmodel.tritontf_model_.get(), init_ops.size(), init_ops.data(),
+        &init_op_usecs));
+    timer.EndPhase("init_ops");
+
+    std::string times;
+    for (const auto& op : init_op_usecs) {
+      times += " " + op.first + "=" + std::to_string(op.second) + "us";
+    }
+    LOG_MESSAGE(
+        TRITONSERVER_LOG_INFO,
+        (std::string("init ops of model '") + Name() + "' on device " +
+         std::to_string(device_id) + ":" + times)
+            .c_str());
+  }
+
+  // Grappler runs within the other phases, mostly the session creation
+  // and the first run of each subgraph.
+  timer.AddPhase(
+      "grappler",
+      LogGrapplerPassTimes(
+          "loading model '" + Name() + "' on device " +
+              std::to_string(device_id),
+          grappler_pass_usecs));
+  ReportLoadPhases(device_id, timer);
+
+  if (!restorable_key.empty()) {
+    std::lock_guard<std::mutex> lock(BackendConfig()->restorable_models_mu_);
+    auto& restorable_models = BackendConfig()->restorable_models_;
+    for (auto it = restorable_models.begin(); it != restorable_models.end();) {
+      if (it->second.tritontf_model_.expired() &&
+          (it->second.parked_model_ == nullptr)) {
+        it = restorable_models.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    restorable_models[restorable_key] = RestorableModel{
+        Name(),
+        device_id,
+        Version(),
+        lmodel.tritontf_model_,
+        nullptr,
+        0,
+        {this},
+        lmodel.input_device_id_,
+        lmodel.input_name_map_,
+        lmodel.output_name_map_,
+        lmodel.signatures_};
+  }
+
+  if (!shared_key.empty()) {
+    std::lock_guard<std::mutex> lock(BackendConfig()->shared_models_mu_);
+    BackendConfig()->shared_models_[shared_key].push_back(
+        SharedModel{lmodel.tritontf_model_, {this}});
+  }
+
+  *model = std::move(lmodel);
+  return nullptr;
+}
+
+TRITONSERVER_Error*
+ModelState::Create(TRITONBACKEND_Model* triton_model, ModelState** state)
+{
+  try {
+    *state = new ModelState(triton_model);
   }
   catch (const BackendModelException& ex) {
     RETURN_ERROR_IF_TRUE(
@@ -1027,14 +2149,317 @@ ModelState::Create(TRITONBACKEND_Model* triton_model, ModelState** state)
 
   RETURN_IF_ERROR((*state)->ValidateModelConfig());
 
+  if ((*state)->BackendConfig()->allocator_metrics_interval_ms_ > 0) {
+    (*state)->StartAllocatorMetrics();
+  }
+  if ((*state)->session_idle_timeout_ns_ > 0) {
+    (*state)->StartIdleSessionReaper();
+  }
+
+  return nullptr;  // success
+}
+
+ModelState::~ModelState()
+{
+  if (idle_session_thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(idle_session_mu_);
+      stop_idle_session_reaper_ = true;
+    }
+    idle_session_cv_.notify_all();
+    idle_session_thread_.join();
+  }
+  if (allocator_metrics_thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(allocator_metrics_mu_);
+      stop_allocator_metrics_ = true;
+    }
+    allocator_metrics_cv_.notify_all();
+    allocator_metrics_thread_.join();
+  }
+  for (const auto& device_metrics : allocator_metrics_) {
+    for (TRITONSERVER_Metric* metric : device_metrics.second) {
+      LOG_IF_ERROR(
+          TRITONSERVER_MetricDelete(metric), "failed to delete metric");
+    }
+  }
+  for (const auto& metric : load_phase_metrics_) {
+    LOG_IF_ERROR(
+        TRITONSERVER_MetricDelete(metric.second), "failed to delete metric");
+  }
+
+  if (share_session_) {
+    std::lock_guard<std::mutex> lock(backend_config_->shared_models_mu_);
+    for (auto& shared : backend_config_->shared_models_) {
+      for (auto& entry : shared.second) {
+        entry.users_.erase(this);
+      }
+    }
+  }
+
+  // Park the sessions that no other loaded version uses, so that a
+  // graph-identical version that loads within the park timeout can
+  // take them over. A session that isn't parked is deleted with the
+  // last model that uses it.
+  if (variable_only_update_) {
+    std::lock_guard<std::mutex> lock(backend_config_->restorable_models_mu_);
+    for (auto& entry : backend_config_->restorable_models_) {
+      RestorableModel& restorable = entry.second;
+      if ((restorable.users_.erase(this) == 0) ||
+          !restorable.users_.empty() || (parked_session_timeout_ns_ == 0)) {
+        continue;
+      }
+      TRITONTFModelHandle handle = restorable.tritontf_model_.lock();
+      for (const auto& device_model : models_) {
+        if (device_model.second.second.tritontf_model_ == handle) {
+          ParkRestorableModel(
+              backend_config_, &restorable, handle,
+              parked_session_timeout_ns_);
+        }
+      }
+    }
+  }
+}
+
+TRITONSERVER_Error*
+ModelState::ReserveCpuMemory(
+    const size_t batch_size, int* micro_batch_count, int64_t* reserved_bytes,
+    bool* trace)
+{
+  std::lock_guard<std::mutex> lock(cpu_memory_mu_);
+  *micro_batch_count = 1;
+  *reserved_bytes = 0;
+
+  // Trace the runs of batches larger than any traced so far. The
+  // estimate is unknown, and nothing is reserved, until the first
+  // traced run completes.
+  *trace = (batch_size > cpu_memory_traced_batch_size_);
+  if (*trace) {
+    cpu_memory_traced_batch_size_ = batch_size;
+  }
+  if (cpu_bytes_per_item_ == 0) {
+    return nullptr;  // success
+  }
+
+  const int64_t available_bytes =
+      std::max(cpu_memory_budget_bytes_ - cpu_memory_reserved_bytes_,
+               static_cast<int64_t>(0));
+  const int64_t needed_bytes = cpu_bytes_per_item_ * batch_size;
+  if (needed_bytes <= available_bytes) {
+    *reserved_bytes = needed_bytes;
+  } else {
+    const int64_t fitting_items =
+        can_split_batch_ ? (available_bytes / cpu_bytes_per_item_) : 0;
+    if (fitting_items < 1) {
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_UNAVAILABLE,
+          (std::string("CPU memory budget of ") +
+           std::to_string(cpu_memory_budget_bytes_) +
+           " bytes exceeded for TensorFlow model '" + Name() +
+           "': a batch of " + std::to_string(batch_size) +
+           " needs an estimated " + std::to_string(needed_bytes) +
+           " bytes, " + std::to_string(available_bytes) +
+           " bytes are available")
+              .c_str());
+    }
+    *micro_batch_count = (batch_size + fitting_items - 1) / fitting_items;
+    *reserved_bytes = fitting_items * cpu_bytes_per_item_;
+  }
+  cpu_memory_reserved_bytes_ += *reserved_bytes;
+
   return nullptr;  // success
 }
 
+void
+ModelState::ReleaseCpuMemory(const int64_t reserved_bytes)
+{
+  std::lock_guard<std::mutex> lock(cpu_memory_mu_);
+  cpu_memory_reserved_bytes_ -= reserved_bytes;
+}
+
+void
+ModelState::RecordCpuMemory(
+    const size_t concurrent_items, const int64_t cpu_bytes)
+{
+  if (concurrent_items == 0) {
+    return;
+  }
+  const int64_t bytes_per_item =
+      (cpu_bytes + concurrent_items - 1) / concurrent_items;
+  std::lock_guard<std::mutex> lock(cpu_memory_mu_);
+  if (bytes_per_item > cpu_bytes_per_item_) {
+    cpu_bytes_per_item_ = bytes_per_item;
+    LOG_MESSAGE(
+        TRITONSERVER_LOG_VERBOSE,
+        (std::string("estimated CPU memory of TensorFlow model '") + Name() +
+         "': " + std::to_string(cpu_bytes_per_item_) + " bytes per batch item")
+            .c_str());
+  }
+}
+
+void
+ModelState::ReportLoadPhases(const int device_id, const LoadPhaseTimer& timer)
+{
+  std::string phases;
+  for (const auto& phase : timer.Phases()) {
+    phases += " " + phase.first + "=" + std::to_string(phase.second) + "us";
+  }
+  LOG_MESSAGE(
+      TRITONSERVER_LOG_INFO,
+      (std::string("load phases of model '") + Name() + "' version " +
+       std::to_string(Version()) + " on device " + std::to_string(device_id) +
+       ":" + phases)
+          .c_str());
+
+  TRITONSERVER_MetricFamily* family =
+      BackendConfig()->load_phase_metric_family_;
+  if (family == nullptr) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(load_phase_metrics_mu_);
+  for (const auto& phase : timer.Phases()) {
+    auto& metric = load_phase_metrics_[std::make_pair(device_id, phase.first)];
+    if (metric == nullptr) {
+      const std::string version = std::to_string(Version());
+      const std::string device = std::to_string(device_id);
+      const TRITONSERVER_Parameter* labels[] = {
+          TRITONSERVER_ParameterNew(
+              "model", TRITONSERVER_PARAMETER_STRING, Name().c_str()),
+          TRITONSERVER_ParameterNew(
+              "version", TRITONSERVER_PARAMETER_STRING, version.c_str()),
+          TRITONSERVER_ParameterNew(
+              "device", TRITONSERVER_PARAMETER_STRING, device.c_str()),
+          TRITONSERVER_ParameterNew(
+              "phase", TRITONSERVER_PARAMETER_STRING, phase.first.c_str())};
+      LOG_IF_ERROR(
+          TRITONSERVER_MetricNew(
+              &metric, family, labels, sizeof(labels) / sizeof(labels[0])),
+          "failed to create load phase metric");
+      for (const TRITONSERVER_Parameter* label : labels) {
+        TRITONSERVER_ParameterDelete(
+            const_cast<TRITONSERVER_Parameter*>(label));
+      }
+    }
+    if (metric != nullptr) {
+      LOG_IF_ERROR(
+          TRITONSERVER_MetricSet(metric, phase.second),
+          "failed to set load phase metric");
+    }
+  }
+}
+
+void
+ModelState::StartAllocatorMetrics()
+{
+  allocator_metrics_thread_ = std::thread([this]() {
+    const auto interval = std::chrono::milliseconds(
+        BackendConfig()->allocator_metrics_interval_ms_);
+    std::unique_lock<std::mutex> lock(allocator_metrics_mu_);
+    while (!stop_allocator_metrics_) {
+      lock.unlock();
+      RefreshAllocatorMetrics();
+      lock.lock();
+      allocator_metrics_cv_.wait_for(
+          lock, interval, [this]() { return stop_allocator_metrics_; });
+    }
+  });
+}
+
+void
+ModelState::RefreshAllocatorMetrics()
+{
+  std::vector<TRITONTFModelHandle> handles;
+  {
+    std::lock_guard<std::mutex> lock(models_mu_);
+    for (const auto& model : models_) {
+      handles.push_back(model.second.second.tritontf_model_);
+    }
+  }
+
+  for (const auto& handle : handles) {
+    std::map<std::string, TRITONTF_AllocatorStats> stats;
+    TRITONTF_Error* tf_err = TRITONTF_ModelAllocatorStats(handle.get(), &stats);
+    if (tf_err != nullptr) {
+      LOG_MESSAGE(
+          TRITONSERVER_LOG_VERBOSE,
+          (std::string("unable to get the allocator statistics of '") +
+           Name() + "': " + tf_err->msg_)
+              .c_str());
+      TRITONTF_ErrorDelete(tf_err);
+      continue;
+    }
+
+    for (const auto& device_stats : stats) {
+      auto& metrics = allocator_metrics_[device_stats.first];
+      if (metrics.empty()) {
+        // Label with the short device name, e.g. 'GPU:0'.
+        std::string device = device_stats.first;
+        const size_t pos = device.find("/device:");
+        if (pos != std::string::npos) {
+          device = device.substr(pos + strlen("/device:"));
+        }
+        const std::string version = std::to_string(Version());
+        const TRITONSERVER_Parameter* labels[] = {
+            TRITONSERVER_ParameterNew(
+                "model", TRITONSERVER_PARAMETER_STRING, Name().c_str()),
+            TRITONSERVER_ParameterNew(
+                "version", TRITONSERVER_PARAMETER_STRING, version.c_str()),
+            TRITONSERVER_ParameterNew(
+                "device", TRITONSERVER_PARAMETER_STRING, device.c_str())};
+        for (TRITONSERVER_MetricFamily* family :
+             BackendConfig()->allocator_metric_families_) {
+          TRITONSERVER_Metric* metric = nullptr;
+          LOG_IF_ERROR(
+              TRITONSERVER_MetricNew(
+                  &metric, family, labels, sizeof(labels) / sizeof(labels[0])),
+              "failed to create allocator metric");
+          metrics.push_back(metric);
+        }
+        for (const TRITONSERVER_Parameter* label : labels) {
+          TRITONSERVER_ParameterDelete(
+              const_cast<TRITONSERVER_Parameter*>(label));
+        }
+      }
+
+      for (size_t i = 0; i < metrics.size(); ++i) {
+        if (metrics[i] != nullptr) {
+          LOG_IF_ERROR(
+              TRITONSERVER_MetricSet(
+                  metrics[i],
+                  device_stats.second.*(kAllocatorMetrics[i].stat_)),
+              "failed to set allocator metric");
+        }
+      }
+    }
+  }
+}
+
 ModelState::ModelState(TRITONBACKEND_Model* triton_model)
     : BackendModel(triton_model), max_session_share_count_(1),
       num_intra_threads_(0), num_inter_threads_(0),
-      use_per_session_threads_(false), graph_tag_(""), signature_def_("")
+      use_per_session_threads_(false), graph_tag_(""), signature_def_(""),
+      sequence_idle_timeout_ns_(0),
+      micro_batch_count_(1), micro_batch_min_size_(0),
+      can_split_batch_(false), thread_pool_name_(""),
+      thread_pool_num_intra_threads_(0), thread_pool_num_inter_threads_(0),
+      thread_pool_per_instance_(false), cpu_cores_(""), numa_node_(-1),
+      has_grappler_config_(false), prune_graph_(false),
+      freeze_variables_(false), variable_only_update_(false),
+      parked_session_timeout_ns_(60000000000),
+      share_session_(false), cpu_memory_budget_bytes_(0),
+      cpu_memory_reserved_bytes_(0), cpu_bytes_per_item_(0),
+      cpu_memory_traced_batch_size_(0), lazy_session_(false),
+      session_idle_timeout_ns_(0), stop_allocator_metrics_(false),
+      stop_idle_session_reaper_(false)
 {
+  grappler_config_.remapping_ = TRITONTF_TOGGLE_DEFAULT;
+  grappler_config_.arithmetic_optimization_ = TRITONTF_TOGGLE_DEFAULT;
+  grappler_config_.dependency_optimization_ = TRITONTF_TOGGLE_DEFAULT;
+  grappler_config_.loop_optimization_ = TRITONTF_TOGGLE_DEFAULT;
+  grappler_config_.memory_optimization_ = TRITONTF_TOGGLE_DEFAULT;
+  grappler_config_.model_pruning_ = TRITONTF_TOGGLE_DEFAULT;
+  grappler_config_.meta_optimizer_iterations_ = 0;
+
   // Obtain backend configuration
   TRITONBACKEND_Backend* backend;
   THROW_IF_BACKEND_MODEL_ERROR(
@@ -1144,39 +2569,766 @@ ModelState::ParseParameters()
         TRITONSERVER_ErrorDelete(err);
       }
     }
-  }
 
-  return nullptr;
-}
+    std::string sequence_state;
+    err = ParseParameter(params, "TF_SEQUENCE_STATE", &sequence_state);
+    if (err != nullptr) {
+      if (TRITONSERVER_ErrorCode(err) != TRITONSERVER_ERROR_NOT_FOUND) {
+        return err;
+      } else {
+        TRITONSERVER_ErrorDelete(err);
+      }
+    } else {
+      RETURN_IF_ERROR(ParseSequenceStates(sequence_state));
+    }
 
-TRITONSERVER_Error*
-ModelState::ParseAndRegisterLibraries()
-{
-  // Register all op libraries that contain custom operations.
-  triton::common::TritonJson::Value model_ops;
-  if (model_config_.Find("model_operations", &model_ops)) {
-    triton::common::TritonJson::Value op_library_filenames;
-    if (model_ops.Find("op_library_filename", &op_library_filenames)) {
-      for (size_t op_idx = 0; op_idx < op_library_filenames.ArraySize();
-           op_idx++) {
-        std::string op_filename;
-        RETURN_IF_ERROR(
-            op_library_filenames.IndexAsString(op_idx, &op_filename));
-        RETURN_IF_TRITONTF_ERROR(
-            TRITONTF_LoadAndRegisterLibrary(op_filename.c_str()));
+    err = ParseParameter(params, "TF_MICRO_BATCH_COUNT", &micro_batch_count_);
+    if (err != nullptr) {
+      if (TRITONSERVER_ErrorCode(err) != TRITONSERVER_ERROR_NOT_FOUND) {
+        return err;
+      } else {
+        TRITONSERVER_ErrorDelete(err);
       }
+    } else if (micro_batch_count_ <= 0) {
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (std::string("parameter 'TF_MICRO_BATCH_COUNT' must be positive "
+                       "number for TensorFlow model '") +
+           Name() + "'")
+              .c_str());
     }
-  }
 
-  return nullptr;
-}
+    err = ParseParameter(
+        params, "TF_MICRO_BATCH_MIN_SIZE", &micro_batch_min_size_);
+    if (err != nullptr) {
+      if (TRITONSERVER_ErrorCode(err) != TRITONSERVER_ERROR_NOT_FOUND) {
+        return err;
+      } else {
+        TRITONSERVER_ErrorDelete(err);
+      }
+    } else if (micro_batch_min_size_ < 0) {
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (std::string("parameter 'TF_MICRO_BATCH_MIN_SIZE' must be "
+                       "non-negative number for TensorFlow model '") +
+           Name() + "'")
+              .c_str());
+    }
 
-// FIXME, where should just be methods in ModelState
-class AutoCompleteHelper {
- public:
-  AutoCompleteHelper(ModelState* model_state, TRITONTF_Model* tritontf_model)
-      : model_state_(model_state),
-        tritontf_model_(tritontf_model, TRITONTF_ModelDelete),
+    err = ParseParameter(params, "TF_THREAD_POOL_NAME", &thread_pool_name_);
+    if (err != nullptr) {
+      if (TRITONSERVER_ErrorCode(err) != TRITONSERVER_ERROR_NOT_FOUND) {
+        return err;
+      } else {
+        TRITONSERVER_ErrorDelete(err);
+      }
+    }
+
+    err = ParseParameter(
+        params, "TF_THREAD_POOL_NUM_INTRA_THREADS",
+        &thread_pool_num_intra_threads_);
+    if (err != nullptr) {
+      if (TRITONSERVER_ErrorCode(err) != TRITONSERVER_ERROR_NOT_FOUND) {
+        return err;
+      } else {
+        TRITONSERVER_ErrorDelete(err);
+      }
+    } else if (thread_pool_num_intra_threads_ < 0) {
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (std::string("parameter 'TF_THREAD_POOL_NUM_INTRA_THREADS' must be "
+                       "non-negative number for TensorFlow model '") +
+           Name() + "'")
+              .c_str());
+    }
+
+    err = ParseParameter(
+        params, "TF_THREAD_POOL_NUM_INTER_THREADS",
+        &thread_pool_num_inter_threads_);
+    if (err != nullptr) {
+      if (TRITONSERVER_ErrorCode(err) != TRITONSERVER_ERROR_NOT_FOUND) {
+        return err;
+      } else {
+        TRITONSERVER_ErrorDelete(err);
+      }
+    } else if (thread_pool_num_inter_threads_ < 0) {
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (std::string("parameter 'TF_THREAD_POOL_NUM_INTER_THREADS' must be "
+                       "non-negative number for TensorFlow model '") +
+           Name() + "'")
+              .c_str());
+    }
+
+    err = ParseParameter(
+        params, "TF_THREAD_POOL_PER_INSTANCE", &thread_pool_per_instance_);
+    if (err != nullptr) {
+      if (TRITONSERVER_ErrorCode(err) != TRITONSERVER_ERROR_NOT_FOUND) {
+        return err;
+      } else {
+        TRITONSERVER_ErrorDelete(err);
+      }
+    }
+
+    err = ParseParameter(params, "TF_CPU_CORES", &cpu_cores_);
+    if (err != nullptr) {
+      if (TRITONSERVER_ErrorCode(err) != TRITONSERVER_ERROR_NOT_FOUND) {
+        return err;
+      } else {
+        TRITONSERVER_ErrorDelete(err);
+      }
+    } else {
+      std::vector<int> cpus;
+      RETURN_IF_ERROR(ParseCpuList(cpu_cores_, &cpus));
+    }
+
+    err = ParseParameter(params, "TF_NUMA_NODE", &numa_node_);
+    if (err != nullptr) {
+      if (TRITONSERVER_ErrorCode(err) != TRITONSERVER_ERROR_NOT_FOUND) {
+        return err;
+      } else {
+        TRITONSERVER_ErrorDelete(err);
+      }
+    } else if (numa_node_ < 0) {
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (std::string("parameter 'TF_NUMA_NODE' must be non-negative "
+                       "number for TensorFlow model '") +
+           Name() + "'")
+              .c_str());
+    }
+
+    // Grappler rewriters keep their TensorFlow default unless the
+    // corresponding parameter is set.
+    const std::vector<std::pair<std::string, TRITONTF_Toggle*>>
+        grappler_toggles{
+            {"TF_GRAPPLER_REMAPPING", &grappler_config_.remapping_},
+            {"TF_GRAPPLER_ARITHMETIC_OPTIMIZATION",
+             &grappler_config_.arithmetic_optimization_},
+            {"TF_GRAPPLER_DEPENDENCY_OPTIMIZATION",
+             &grappler_config_.dependency_optimization_},
+            {"TF_GRAPPLER_LOOP_OPTIMIZATION",
+             &grappler_config_.loop_optimization_},
+            {"TF_GRAPPLER_MEMORY_OPTIMIZATION",
+             &grappler_config_.memory_optimization_},
+            {"TF_GRAPPLER_MODEL_PRUNING", &grappler_config_.model_pruning_}};
+    for (const auto& toggle : grappler_toggles) {
+      bool enable = false;
+      err = ParseParameter(params, toggle.first, &enable);
+      if (err != nullptr) {
+        if (TRITONSERVER_ErrorCode(err) != TRITONSERVER_ERROR_NOT_FOUND) {
+          return err;
+        } else {
+          TRITONSERVER_ErrorDelete(err);
+        }
+      } else {
+        *toggle.second = enable ? TRITONTF_TOGGLE_ON : TRITONTF_TOGGLE_OFF;
+        has_grappler_config_ = true;
+      }
+    }
+
+    err = ParseParameter(
+        params, "TF_GRAPPLER_META_OPTIMIZER_ITERATIONS",
+        &grappler_config_.meta_optimizer_iterations_);
+    if (err != nullptr) {
+      if (TRITONSERVER_ErrorCode(err) != TRITONSERVER_ERROR_NOT_FOUND) {
+        return err;
+      } else {
+        TRITONSERVER_ErrorDelete(err);
+      }
+    } else if (
+        (grappler_config_.meta_optimizer_iterations_ != 1) &&
+        (grappler_config_.meta_optimizer_iterations_ != 2)) {
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (std::string("parameter 'TF_GRAPPLER_META_OPTIMIZER_ITERATIONS' "
+                       "must be 1 or 2 for TensorFlow model '") +
+           Name() + "'")
+              .c_str());
+    } else {
+      has_grappler_config_ = true;
+    }
+
+    err = ParseParameter(params, "TF_PRUNE_GRAPH", &prune_graph_);
+    if (err != nullptr) {
+      if (TRITONSERVER_ErrorCode(err) != TRITONSERVER_ERROR_NOT_FOUND) {
+        return err;
+      } else {
+        TRITONSERVER_ErrorDelete(err);
+      }
+    }
+
+    err = ParseParameter(params, "TF_FREEZE_VARIABLES", &freeze_variables_);
+    if (err != nullptr) {
+      if (TRITONSERVER_ErrorCode(err) != TRITONSERVER_ERROR_NOT_FOUND) {
+        return err;
+      } else {
+        TRITONSERVER_ErrorDelete(err);
+      }
+    }
+
+    err = ParseParameter(
+        params, "TF_VARIABLE_ONLY_UPDATE", &variable_only_update_);
+    if (err != nullptr) {
+      if (TRITONSERVER_ErrorCode(err) != TRITONSERVER_ERROR_NOT_FOUND) {
+        return err;
+      } else {
+        TRITONSERVER_ErrorDelete(err);
+      }
+    } else if (variable_only_update_ && (is_graphdef_ || freeze_variables_)) {
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (std::string("parameter 'TF_VARIABLE_ONLY_UPDATE' requires a "
+                       "SavedModel without 'TF_FREEZE_VARIABLES' for "
+                       "TensorFlow model '") +
+           Name() + "'")
+              .c_str());
+    }
+
+    int parked_session_timeout_ms = 0;
+    err = ParseParameter(
+        params, "TF_PARKED_SESSION_TIMEOUT_MS", &parked_session_timeout_ms);
+    if (err != nullptr) {
+      if (TRITONSERVER_ErrorCode(err) != TRITONSERVER_ERROR_NOT_FOUND) {
+        return err;
+      } else {
+        TRITONSERVER_ErrorDelete(err);
+      }
+    } else if (parked_session_timeout_ms < 0) {
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (std::string("parameter 'TF_PARKED_SESSION_TIMEOUT_MS' must be "
+                       "non-negative for TensorFlow model '") +
+           Name() + "'")
+              .c_str());
+    } else {
+      parked_session_timeout_ns_ =
+          static_cast<uint64_t>(parked_session_timeout_ms) * 1000000;
+    }
+
+    std::string signature_defs;
+    err = ParseParameter(params, "TF_SIGNATURE_DEFS", &signature_defs);
+    if (err != nullptr) {
+      if (TRITONSERVER_ErrorCode(err) != TRITONSERVER_ERROR_NOT_FOUND) {
+        return err;
+      } else {
+        TRITONSERVER_ErrorDelete(err);
+      }
+    } else if (!signature_defs.empty()) {
+      if (is_graphdef_ || !sequence_states_.empty()) {
+        return TRITONSERVER_ErrorNew(
+            TRITONSERVER_ERROR_INVALID_ARG,
+            (std::string("parameter 'TF_SIGNATURE_DEFS' requires a "
+                         "SavedModel without 'TF_SEQUENCE_STATE' for "
+                         "TensorFlow model '") +
+             Name() + "'")
+                .c_str());
+      }
+      for (const auto& signature_def : SplitString(signature_defs, ',')) {
+        if (signature_def.empty() || (signature_def == signature_def_)) {
+          return TRITONSERVER_ErrorNew(
+              TRITONSERVER_ERROR_INVALID_ARG,
+              (std::string("parameter 'TF_SIGNATURE_DEFS' must be a "
+                           "comma-separated list of signatures other than "
+                           "'TF_SIGNATURE_DEF' for TensorFlow model '") +
+               Name() + "'")
+                  .c_str());
+        }
+        signature_defs_.push_back(signature_def);
+      }
+    }
+
+    std::string ragged_length_buckets;
+    err = ParseParameter(
+        params, "TF_RAGGED_LENGTH_BUCKETS", &ragged_length_buckets);
+    if (err != nullptr) {
+      if (TRITONSERVER_ErrorCode(err) != TRITONSERVER_ERROR_NOT_FOUND) {
+        return err;
+      } else {
+        TRITONSERVER_ErrorDelete(err);
+      }
+    } else if (!ragged_length_buckets.empty()) {
+      for (const auto& bound_str : SplitString(ragged_length_buckets, ',')) {
+        int64_t bound = 0;
+        err = ParseLongLongValue(bound_str, &bound);
+        if (err != nullptr) {
+          TRITONSERVER_ErrorDelete(err);
+          bound = 0;
+        }
+        if ((bound <= 0) || (!ragged_length_buckets_.empty() &&
+                             (bound <= ragged_length_buckets_.back()))) {
+          return TRITONSERVER_ErrorNew(
+              TRITONSERVER_ERROR_INVALID_ARG,
+              (std::string("parameter 'TF_RAGGED_LENGTH_BUCKETS' must be a "
+                           "comma-separated list of increasing positive "
+                           "lengths for TensorFlow model '") +
+               Name() + "'")
+                  .c_str());
+        }
+        ragged_length_buckets_.push_back(bound);
+      }
+    }
+
+    std::string pad_inputs, crop_outputs;
+    err = ParseParameter(params, "TF_PAD_INPUTS", &pad_inputs);
+    if (err != nullptr) {
+      if (TRITONSERVER_ErrorCode(err) != TRITONSERVER_ERROR_NOT_FOUND) {
+        return err;
+      } else {
+        TRITONSERVER_ErrorDelete(err);
+      }
+    }
+    err = ParseParameter(params, "TF_CROP_OUTPUTS", &crop_outputs);
+    if (err != nullptr) {
+      if (TRITONSERVER_ErrorCode(err) != TRITONSERVER_ERROR_NOT_FOUND) {
+        return err;
+      } else {
+        TRITONSERVER_ErrorDelete(err);
+      }
+    }
+    if (!pad_inputs.empty() || !crop_outputs.empty()) {
+      RETURN_IF_ERROR(ParsePadding(pad_inputs, crop_outputs));
+    }
+
+    std::string broadcast_inputs;
+    err = ParseParameter(params, "TF_BROADCAST_INPUTS", &broadcast_inputs);
+    if (err != nullptr) {
+      if (TRITONSERVER_ErrorCode(err) != TRITONSERVER_ERROR_NOT_FOUND) {
+        return err;
+      } else {
+        TRITONSERVER_ErrorDelete(err);
+      }
+    } else if (!broadcast_inputs.empty()) {
+      RETURN_IF_ERROR(ParseBroadcastInputs(broadcast_inputs));
+    }
+
+    int cpu_memory_budget_mb = 0;
+    err = ParseParameter(
+        params, "TF_CPU_MEMORY_BUDGET_MB", &cpu_memory_budget_mb);
+    if (err != nullptr) {
+      if (TRITONSERVER_ErrorCode(err) != TRITONSERVER_ERROR_NOT_FOUND) {
+        return err;
+      } else {
+        TRITONSERVER_ErrorDelete(err);
+      }
+    } else if (cpu_memory_budget_mb < 0) {
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (std::string("parameter 'TF_CPU_MEMORY_BUDGET_MB' must be "
+                       "non-negative for TensorFlow model '") +
+           Name() + "'")
+              .c_str());
+    } else {
+      cpu_memory_budget_bytes_ =
+          static_cast<int64_t>(cpu_memory_budget_mb) * 1024 * 1024;
+    }
+
+    err = ParseParameter(params, "TF_SHARE_SESSION", &share_session_);
+    if (err != nullptr) {
+      if (TRITONSERVER_ErrorCode(err) != TRITONSERVER_ERROR_NOT_FOUND) {
+        return err;
+      } else {
+        TRITONSERVER_ErrorDelete(err);
+      }
+    } else if (share_session_ && variable_only_update_) {
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (std::string("parameter 'TF_SHARE_SESSION' can't be used with "
+                       "'TF_VARIABLE_ONLY_UPDATE' for TensorFlow model '") +
+           Name() + "'")
+              .c_str());
+    }
+
+    err = ParseParameter(params, "TF_LAZY_SESSION", &lazy_session_);
+    if (err != nullptr) {
+      if (TRITONSERVER_ErrorCode(err) != TRITONSERVER_ERROR_NOT_FOUND) {
+        return err;
+      } else {
+        TRITONSERVER_ErrorDelete(err);
+      }
+    }
+
+    int session_idle_timeout_ms = 0;
+    err = ParseParameter(
+        params, "TF_SESSION_IDLE_TIMEOUT_MS", &session_idle_timeout_ms);
+    if (err != nullptr) {
+      if (TRITONSERVER_ErrorCode(err) != TRITONSERVER_ERROR_NOT_FOUND) {
+        return err;
+      } else {
+        TRITONSERVER_ErrorDelete(err);
+      }
+    } else if (session_idle_timeout_ms < 0) {
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (std::string("parameter 'TF_SESSION_IDLE_TIMEOUT_MS' must be "
+                       "non-negative for TensorFlow model '") +
+           Name() + "'")
+              .c_str());
+    } else {
+      session_idle_timeout_ns_ =
+          static_cast<uint64_t>(session_idle_timeout_ms) * 1000000;
+    }
+  }
+
+  return nullptr;
+}
+
+TRITONSERVER_Error*
+ModelState::GetThreadPools(
+    const std::string& instance_name, const std::vector<int>& cpus,
+    const int numa_node, std::shared_ptr<TRITONTF_ThreadPools>* thread_pools)
+{
+  thread_pools->reset();
+  const bool has_affinity = (!cpus.empty() || (numa_node >= 0));
+  int num_intra_threads = thread_pool_num_intra_threads_;
+  int num_inter_threads = thread_pool_num_inter_threads_;
+  if (has_affinity) {
+    // Threads of the session pools can't be pinned, so size the
+    // instance pools after its CPUs, or the CPUs of its NUMA node,
+    // unless the sizes are given. The CPUs are split between the pools:
+    // a quarter of them, at least one, run inter-op work and the rest
+    // intra-op work.
+    std::vector<int> node_cpus;
+    if (cpus.empty()) {
+      RETURN_IF_ERROR(NumaNodeCpus(numa_node, &node_cpus));
+    }
+    const int num_cpus =
+        cpus.empty() ? (int)node_cpus.size() : (int)cpus.size();
+    if (num_inter_threads <= 0) {
+      num_inter_threads = (num_intra_threads > 0)
+                              ? std::max(num_cpus - num_intra_threads, 1)
+                              : std::max(num_cpus / 4, 1);
+    }
+    if (num_intra_threads <= 0) {
+      num_intra_threads = std::max(num_cpus - num_inter_threads, 1);
+    }
+  } else if (
+      thread_pool_name_.empty() ||
+      ((num_intra_threads == 0) && (num_inter_threads == 0))) {
+    return nullptr;  // success
+  }
+
+  std::string pool_name =
+      thread_pool_name_.empty() ? Name() : thread_pool_name_;
+  if (thread_pool_per_instance_ || has_affinity) {
+    pool_name += "_" + instance_name;
+  }
+
+  std::lock_guard<std::mutex> lock(backend_config_->thread_pools_mu_);
+  auto& entry = backend_config_->thread_pools_[pool_name];
+  *thread_pools = entry.lock();
+  if (*thread_pools == nullptr) {
+    TRITONTF_ThreadPools* pools = nullptr;
+    RETURN_IF_TRITONTF_ERROR(TRITONTF_ThreadPoolsNew(
+        &pools, pool_name.c_str(), num_intra_threads, num_inter_threads,
+        cpus.data(), cpus.size(), numa_node));
+    thread_pools->reset(pools, TRITONTF_ThreadPoolsDelete);
+    entry = *thread_pools;
+
+    LOG_MESSAGE(
+        TRITONSERVER_LOG_INFO,
+        (std::string("created thread pools '") + pool_name + "' with " +
+         std::to_string(num_intra_threads) + " intra-op threads and " +
+         std::to_string(num_inter_threads) + " inter-op threads" +
+         (cpus.empty() ? std::string()
+                       : (", pinned to " + std::to_string(cpus.size()) +
+                          " CPUs")) +
+         ((numa_node < 0) ? std::string()
+                          : (", on NUMA node " + std::to_string(numa_node))))
+            .c_str());
+  }
+
+  return nullptr;  // success
+}
+
+TRITONSERVER_Error*
+ModelState::ParseBroadcastInputs(const std::string& spec)
+{
+  // A batching model can't take inputs with different batch sizes in
+  // one request, so broadcasting is along the first dimension of the
+  // inputs of a model without batching.
+  RETURN_ERROR_IF_TRUE(
+      MaxBatchSize() != 0, TRITONSERVER_ERROR_INVALID_ARG,
+      std::string("parameter 'TF_BROADCAST_INPUTS' requires a model without "
+                  "batching support for TensorFlow model '") +
+          Name() + "'");
+
+  std::map<std::string, std::string> input_datatypes;
+  triton::common::TritonJson::Value ios;
+  RETURN_IF_ERROR(ModelConfig().MemberAsArray("input", &ios));
+  for (size_t i = 0; i < ios.ArraySize(); i++) {
+    triton::common::TritonJson::Value io;
+    RETURN_IF_ERROR(ios.IndexAsObject(i, &io));
+    std::string io_name, io_dtype;
+    RETURN_IF_ERROR(io.MemberAsString("name", &io_name));
+    RETURN_IF_ERROR(io.MemberAsString("data_type", &io_dtype));
+    input_datatypes[io_name] = io_dtype;
+  }
+
+  // Each broadcast input is specified as
+  // '<input_name>:<reference_input_name>' and multiple inputs are
+  // separated by ';'.
+  for (const auto& entry : SplitString(spec, ';')) {
+    if (entry.empty()) {
+      continue;
+    }
+    const auto fields = SplitString(entry, ':');
+    RETURN_ERROR_IF_FALSE(
+        fields.size() == 2, TRITONSERVER_ERROR_INVALID_ARG,
+        std::string("parameter 'TF_BROADCAST_INPUTS' must be a ';' separated "
+                    "list of '<input_name>:<reference_input_name>' for "
+                    "TensorFlow model '") +
+            Name() + "', got '" + entry + "'");
+    const auto itr = input_datatypes.find(fields[0]);
+    RETURN_ERROR_IF_TRUE(
+        (itr == input_datatypes.end()) || (itr->second == "TYPE_STRING"),
+        TRITONSERVER_ERROR_INVALID_ARG,
+        std::string("broadcast input '") + fields[0] +
+            "' must be a non-string input for TensorFlow model '" + Name() +
+            "'");
+    RETURN_ERROR_IF_TRUE(
+        (fields[1] == fields[0]) ||
+            (input_datatypes.find(fields[1]) == input_datatypes.end()),
+        TRITONSERVER_ERROR_INVALID_ARG,
+        std::string("broadcast input '") + fields[0] +
+            "' must follow another input for TensorFlow model '" + Name() +
+            "'");
+    broadcast_inputs_[fields[0]] = fields[1];
+  }
+
+  // A reference input that is broadcast itself would depend on the
+  // order the inputs are collected in.
+  for (const auto& broadcast : broadcast_inputs_) {
+    RETURN_ERROR_IF_TRUE(
+        broadcast_inputs_.find(broadcast.second) != broadcast_inputs_.end(),
+        TRITONSERVER_ERROR_INVALID_ARG,
+        std::string("broadcast input '") + broadcast.first +
+            "' can't follow broadcast input '" + broadcast.second +
+            "' for TensorFlow model '" + Name() + "'");
+  }
+
+  return nullptr;  // success
+}
+
+TRITONSERVER_Error*
+ModelState::ParsePadding(
+    const std::string& pad_spec, const std::string& crop_spec)
+{
+  RETURN_ERROR_IF_TRUE(
+      MaxBatchSize() == 0, TRITONSERVER_ERROR_INVALID_ARG,
+      std::string("parameters 'TF_PAD_INPUTS' and 'TF_CROP_OUTPUTS' require "
+                  "batching support for TensorFlow model '") +
+          Name() + "'");
+
+  // Each padded input is specified as
+  // '<input_name>:<pad_value>[:<multiple>]' and multiple inputs are
+  // separated by ';'.
+  std::map<std::string, std::string> input_datatypes, output_datatypes;
+  triton::common::TritonJson::Value ios;
+  RETURN_IF_ERROR(ModelConfig().MemberAsArray("input", &ios));
+  for (size_t i = 0; i < ios.ArraySize(); i++) {
+    triton::common::TritonJson::Value io;
+    RETURN_IF_ERROR(ios.IndexAsObject(i, &io));
+    std::string io_name, io_dtype;
+    RETURN_IF_ERROR(io.MemberAsString("name", &io_name));
+    RETURN_IF_ERROR(io.MemberAsString("data_type", &io_dtype));
+    input_datatypes[io_name] = io_dtype;
+  }
+  RETURN_IF_ERROR(ModelConfig().MemberAsArray("output", &ios));
+  for (size_t i = 0; i < ios.ArraySize(); i++) {
+    triton::common::TritonJson::Value io;
+    RETURN_IF_ERROR(ios.IndexAsObject(i, &io));
+    std::string io_name, io_dtype;
+    RETURN_IF_ERROR(io.MemberAsString("name", &io_name));
+    RETURN_IF_ERROR(io.MemberAsString("data_type", &io_dtype));
+    output_datatypes[io_name] = io_dtype;
+  }
+
+  for (const auto& entry : SplitString(pad_spec, ';')) {
+    if (entry.empty()) {
+      continue;
+    }
+    const auto fields = SplitString(entry, ':');
+    PaddedInputConfig config{0, 1};
+    bool valid = ((fields.size() == 2) || (fields.size() == 3));
+    if (valid) {
+      TRITONSERVER_Error* err = ParseDoubleValue(fields[1], &config.pad_value_);
+      if ((err == nullptr) && (fields.size() == 3)) {
+        err = ParseLongLongValue(fields[2], &config.multiple_);
+      }
+      if (err != nullptr) {
+        TRITONSERVER_ErrorDelete(err);
+        valid = false;
+      }
+    }
+    RETURN_ERROR_IF_FALSE(
+        valid && (config.multiple_ > 0), TRITONSERVER_ERROR_INVALID_ARG,
+        std::string("parameter 'TF_PAD_INPUTS' must be a ';' separated list "
+                    "of '<input_name>:<pad_value>[:<multiple>]' with a "
+                    "positive multiple for TensorFlow model '") +
+            Name() + "', got '" + entry + "'");
+
+    const auto itr = input_datatypes.find(fields[0]);
+    RETURN_ERROR_IF_TRUE(
+        (itr == input_datatypes.end()) || !IsInputRagged(fields[0]),
+        TRITONSERVER_ERROR_INVALID_ARG,
+        std::string("padded input '") + fields[0] +
+            "' must be an input that allows ragged batches for TensorFlow "
+            "model '" +
+            Name() + "'");
+    // Check that the input can be filled with the pad value.
+    char pad[sizeof(double)];
+    TRITONSERVER_Error* err = FillTensorValue(
+        pad, 1, ModelConfigDataTypeToTritonServerDataType(itr->second),
+        config.pad_value_);
+    if (err != nullptr) {
+      const std::string msg = TRITONSERVER_ErrorMessage(err);
+      TRITONSERVER_ErrorDelete(err);
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (std::string("unable to pad input '") + fields[0] +
+           "' for TensorFlow model '" + Name() + "': " + msg)
+              .c_str());
+    }
+    padded_inputs_[fields[0]] = config;
+  }
+
+  // Each cropped output is specified as '<output_name>:<input_name>'
+  // and multiple outputs are separated by ';'.
+  for (const auto& entry : SplitString(crop_spec, ';')) {
+    if (entry.empty()) {
+      continue;
+    }
+    const auto fields = SplitString(entry, ':');
+    RETURN_ERROR_IF_FALSE(
+        fields.size() == 2, TRITONSERVER_ERROR_INVALID_ARG,
+        std::string("parameter 'TF_CROP_OUTPUTS' must be a ';' separated "
+                    "list of '<output_name>:<input_name>' for TensorFlow "
+                    "model '") +
+            Name() + "', got '" + entry + "'");
+    const auto itr = output_datatypes.find(fields[0]);
+    RETURN_ERROR_IF_TRUE(
+        (itr == output_datatypes.end()) || (itr->second == "TYPE_STRING") ||
+            (FindBatchOutput(fields[0]) != nullptr),
+        TRITONSERVER_ERROR_INVALID_ARG,
+        std::string("cropped output '") + fields[0] +
+            "' must be a non-string output that is not a batch output for "
+            "TensorFlow model '" +
+            Name() + "'");
+    RETURN_ERROR_IF_TRUE(
+        padded_inputs_.find(fields[1]) == padded_inputs_.end(),
+        TRITONSERVER_ERROR_INVALID_ARG,
+        std::string("cropped output '") + fields[0] + "' must follow an input "
+            "in 'TF_PAD_INPUTS' for TensorFlow model '" + Name() + "'");
+    cropped_outputs_[fields[0]] = fields[1];
+  }
+
+  return nullptr;  // success
+}
+
+TRITONSERVER_Error*
+ModelState::ParseSequenceStates(const std::string& spec)
+{
+  triton::common::TritonJson::Value sequence_batching;
+  RETURN_ERROR_IF_FALSE(
+      ModelConfig().Find("sequence_batching", &sequence_batching),
+      TRITONSERVER_ERROR_INVALID_ARG,
+      std::string("parameter 'TF_SEQUENCE_STATE' requires sequence batching "
+                  "for TensorFlow model '") +
+          Name() + "'");
+
+  // Each state is specified as
+  // '<input_name>:<output_name>:<data_type>:<dims>' and multiple
+  // states are separated by ';'. 'dims' excludes the batch dimension
+  // and must be fixed-size as it is used to create the initial
+  // (zero) state of a sequence.
+  for (const auto& entry : SplitString(spec, ';')) {
+    if (entry.empty()) {
+      continue;
+    }
+    const auto fields = SplitString(entry, ':');
+    RETURN_ERROR_IF_FALSE(
+        fields.size() == 4, TRITONSERVER_ERROR_INVALID_ARG,
+        std::string("invalid sequence state '") + entry +
+            "' for TensorFlow model '" + Name() +
+            "', expected '<input_name>:<output_name>:<data_type>:<dims>'");
+
+    SequenceStateConfig state;
+    state.input_name_ = fields[0];
+    state.output_name_ = fields[1];
+    state.datatype_ = ConvertDataType(ConvertDataType(fields[2]));
+    RETURN_ERROR_IF_TRUE(
+        (state.datatype_ == TRITONSERVER_TYPE_INVALID) ||
+            (state.datatype_ == TRITONSERVER_TYPE_BYTES),
+        TRITONSERVER_ERROR_INVALID_ARG,
+        std::string("unsupported datatype '") + fields[2] +
+            "' for sequence state '" + state.input_name_ +
+            "' for TensorFlow model '" + Name() + "'");
+    for (const auto& dim : SplitString(fields[3], ',')) {
+      int64_t d;
+      RETURN_IF_ERROR(ParseLongLongValue(dim, &d));
+      RETURN_ERROR_IF_TRUE(
+          d <= 0, TRITONSERVER_ERROR_INVALID_ARG,
+          std::string("sequence state '") + state.input_name_ +
+              "' for TensorFlow model '" + Name() +
+              "' must have fixed-size dimensions");
+      state.dims_.push_back(d);
+    }
+    sequence_states_.emplace_back(std::move(state));
+  }
+
+  // The state of a sequence is released once the sequence batcher
+  // would consider the sequence idle, which is 1 second by default.
+  uint64_t idle_us = 1000000;
+  triton::common::TritonJson::Value idle_json;
+  if (sequence_batching.Find("max_sequence_idle_microseconds", &idle_json)) {
+    // 64-bit values may be represented as string in the JSON config.
+    std::string idle_str;
+    auto err = idle_json.AsString(&idle_str);
+    if (err == nullptr) {
+      int64_t lidle;
+      RETURN_IF_ERROR(ParseLongLongValue(idle_str, &lidle));
+      idle_us = (lidle > 0) ? lidle : idle_us;
+    } else {
+      TRITONSERVER_ErrorDelete(err);
+      uint64_t lidle;
+      RETURN_IF_ERROR(idle_json.AsUInt(&lidle));
+      idle_us = (lidle > 0) ? lidle : idle_us;
+    }
+  }
+  sequence_idle_timeout_ns_ = idle_us * 1000;
+
+  return nullptr;
+}
+
+TRITONSERVER_Error*
+ModelState::ParseAndRegisterLibraries()
+{
+  // Register all op libraries that contain custom operations.
+  triton::common::TritonJson::Value model_ops;
+  if (model_config_.Find("model_operations", &model_ops)) {
+    triton::common::TritonJson::Value op_library_filenames;
+    if (model_ops.Find("op_library_filename", &op_library_filenames)) {
+      for (size_t op_idx = 0; op_idx < op_library_filenames.ArraySize();
+           op_idx++) {
+        std::string op_filename;
+        RETURN_IF_ERROR(
+            op_library_filenames.IndexAsString(op_idx, &op_filename));
+        RETURN_IF_TRITONTF_ERROR(
+            TRITONTF_LoadAndRegisterLibrary(op_filename.c_str()));
+      }
+    }
+  }
+
+  return nullptr;
+}
+
+// FIXME, where should just be methods in ModelState
+class AutoCompleteHelper {
+ public:
+  AutoCompleteHelper(ModelState* model_state, TRITONTF_Model* tritontf_model)
+      : model_state_(model_state),
+        tritontf_model_(tritontf_model, TRITONTF_ModelDelete),
         using_ragged_batching_(false)
   {
   }
@@ -1422,503 +3574,1550 @@ AutoCompleteHelper::FixBatchingSupport()
   }
 
 
-  return nullptr;  // success
-}
+  return nullptr;  // success
+}
+
+TRITONSERVER_Error*
+AutoCompleteHelper::FillMissingValues(
+    const TRITONTF_IO* io, triton::common::TritonJson::Value& io_config)
+{
+  triton::common::TritonJson::Value tmp(
+      model_state_->ModelConfig(),
+      triton::common::TritonJson::ValueType::OBJECT);
+
+  bool is_empty_io = io_config.IsEmpty();
+  if (!is_empty_io && !io_config.Find("name", &tmp)) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INVALID_ARG,
+        (std::string("'name' is a required field for all inputs/outputs."))
+            .c_str());
+  }
+
+  // If this I/O is empty then we are using the model
+  // to autocomplete.
+  if (is_empty_io) {
+    RETURN_IF_ERROR(io_config.SetStringObject("name", io->name_));
+  }
+
+  bool found_config_data_type = io_config.Find("data_type", &tmp);
+  std::string data_type_str;
+  if (found_config_data_type) {
+    RETURN_IF_ERROR(tmp.AsString(&data_type_str));
+  }
+  bool should_auto_complete_data_type =
+      !found_config_data_type || DataTypeIsInvalid(data_type_str);
+  if (should_auto_complete_data_type) {
+    RETURN_IF_ERROR(io_config.SetStringObject(
+        "data_type", ConvertToModelConfigString(io->data_type_)));
+  }
+
+  bool found_dims = io_config.Find("dims", &tmp);
+  bool should_auto_complete_dims = !found_dims || (tmp.ArraySize() == 0);
+  if (should_auto_complete_dims) {
+    RETURN_ERROR_IF_TRUE(
+        io->shape_->rank_ == 0, TRITONSERVER_ERROR_INVALID_ARG,
+        std::string(
+            "Unable to autofill for '" + model_state_->Name() +
+            "': the rank of model tensor '" + io->name_ +
+            "' is 0 and dimensions are not defined"));
+    // The model signature supports batching then the first
+    // dimension is -1 and should not appear in the model
+    // configuration 'dims' that we are creating.
+    triton::common::TritonJson::Value dims(
+        model_state_->ModelConfig(),
+        triton::common::TritonJson::ValueType::ARRAY);
+
+    for (size_t i = (model_support_batching_ ? 1 : 0); i < io->shape_->rank_;
+         ++i) {
+      RETURN_IF_ERROR(dims.AppendInt(io->shape_->dims_[i]));
+    }
+    if (dims.ArraySize() == 0) {
+      RETURN_IF_ERROR(dims.AppendInt(1));
+      triton::common::TritonJson::Value reshape(
+          model_state_->ModelConfig(),
+          triton::common::TritonJson::ValueType::OBJECT);
+      triton::common::TritonJson::Value reshape_dims(
+          model_state_->ModelConfig(),
+          triton::common::TritonJson::ValueType::ARRAY);
+      RETURN_IF_ERROR(reshape.Add("shape", std::move(reshape_dims)));
+      RETURN_IF_ERROR(io_config.Add("reshape", std::move(reshape)));
+    }
+
+    if (found_dims) {
+      RETURN_IF_ERROR(io_config.Remove("dims"));
+    }
+    RETURN_IF_ERROR(io_config.Add("dims", std::move(dims)));
+  }  // end of should_auto_complete_dims
+
+  return nullptr;  // Success
+}
+
+void
+AutoCompleteHelper::RemoveByName(
+    const char* name, std::vector<const TRITONTF_IOList*>& list)
+{
+  for (size_t i = 0; i < list.size(); ++i) {
+    const TRITONTF_IOList* current = list.at(i);
+    if (!strcmp(name, current->io_->name_)) {
+      list.erase(list.begin() + i);
+      return;
+    }
+  }
+}
+
+void
+AutoCompleteHelper::CopyList(
+    const TRITONTF_IOList* src, std::vector<const TRITONTF_IOList*>& dst)
+{
+  while (src != nullptr) {
+    dst.push_back(src);
+    src = src->next_;
+  }
+}
+
+TRITONSERVER_Error*
+AutoCompleteHelper::FixConfigInputs(const TRITONTF_IOList* reference_list)
+{
+  // Replace I/O even if inputs / outputs are specified in config.
+  triton::common::TritonJson::Value ios;
+  model_state_->ModelConfig().Find("input", &ios);
+
+  // Iterate through the model config inputs and keep track of
+  // the ones which we found in the model. Any inputs left in the
+  // model list, we will attempt to autocomplete after. In the
+  // event there is an input which is in the model config but
+  // not in the model, we defer this check till later.
+  std::vector<const TRITONTF_IOList*> reference_list_copy;
+  CopyList(reference_list, reference_list_copy);
+
+  triton::common::TritonJson::Value current_io(
+      model_state_->ModelConfig(),
+      triton::common::TritonJson::ValueType::OBJECT);
+  for (size_t i = 0; i < ios.ArraySize(); ++i) {
+    RETURN_IF_ERROR(ios.IndexAsObject(i, &current_io));
+
+    triton::common::TritonJson::Value current_name(
+        model_state_->ModelConfig(),
+        triton::common::TritonJson::ValueType::OBJECT);
+    std::string config_name;
+    RETURN_IF_ERROR(current_io.MemberAsString("name", &config_name));
+
+    const TRITONTF_IO* io = FindIOByName(reference_list_copy, config_name);
+    if (io == nullptr) {
+      continue;
+    }
+
+    RETURN_IF_ERROR(FillMissingValues(io, current_io));
+
+    RemoveByName(io->name_, reference_list_copy);
+  }
+
+  // Ragged batching can have batch_input which are inputs in the
+  // the model config. Unfortunately these cannot autocomplete,
+  // so just check them off so they're not duplicated.
+  triton::common::TritonJson::Value batch_inputs(
+      model_state_->ModelConfig(),
+      triton::common::TritonJson::ValueType::ARRAY);
+  model_state_->ModelConfig().Find("batch_input", &batch_inputs);
+  for (size_t i = 0; i < batch_inputs.ArraySize(); ++i) {
+    RETURN_IF_ERROR(batch_inputs.IndexAsObject(i, &current_io));
+
+    triton::common::TritonJson::Value target_names(
+        model_state_->ModelConfig(),
+        triton::common::TritonJson::ValueType::ARRAY);
+    RETURN_IF_ERROR(current_io.MemberAsArray("target_name", &target_names));
+
+    std::string current_name_str;
+    for (size_t j = 0; j < target_names.ArraySize(); ++j) {
+      RETURN_IF_ERROR(target_names.IndexAsString(j, &current_name_str));
+
+      const TRITONTF_IO* io =
+          FindIOByName(reference_list_copy, current_name_str);
+      if (io == nullptr) {
+        continue;
+      }
+
+      RemoveByName(io->name_, reference_list_copy);
+    }
+  }
+
+  // Sequence_batching::control_input cannot be autocompleted, check off the
+  // names the same as ragged batching
+  triton::common::TritonJson::Value sequence_batching;
+  bool found_sequence_batching =
+      model_state_->ModelConfig().Find("sequence_batching", &sequence_batching);
+  if (found_sequence_batching) {
+    triton::common::TritonJson::Value control_inputs(
+        model_state_->ModelConfig(),
+        triton::common::TritonJson::ValueType::ARRAY);
+    sequence_batching.Find("control_input", &control_inputs);
+    for (size_t i = 0; i < control_inputs.ArraySize(); ++i) {
+      RETURN_IF_ERROR(control_inputs.IndexAsObject(i, &current_io));
+
+      std::string name;
+      RETURN_IF_ERROR(current_io.MemberAsString("name", &name));
+
+      const TRITONTF_IO* io = FindIOByName(reference_list_copy, name);
+      if (io == nullptr) {
+        continue;
+      }
+
+      RemoveByName(io->name_, reference_list_copy);
+    }
+  }
+
+  // Sequence states are fed by the backend and so must not be added
+  // as configuration inputs.
+  for (const auto& state : model_state_->SequenceStates()) {
+    RemoveByName(state.input_name_.c_str(), reference_list_copy);
+  }
+
+  // Adding configuration from inputs detected in the loaded model
+  // but not found in the model configuration.
+  for (size_t i = 0; i < reference_list_copy.size(); ++i) {
+    const TRITONTF_IOList* current = reference_list_copy.at(i);
+    TRITONTF_IO* io = current->io_;
 
-TRITONSERVER_Error*
-AutoCompleteHelper::FillMissingValues(
-    const TRITONTF_IO* io, triton::common::TritonJson::Value& io_config)
-{
-  triton::common::TritonJson::Value tmp(
-      model_state_->ModelConfig(),
-      triton::common::TritonJson::ValueType::OBJECT);
+    triton::common::TritonJson::Value blank_value(
+        model_state_->ModelConfig(),
+        triton::common::TritonJson::ValueType::OBJECT);
 
-  bool is_empty_io = io_config.IsEmpty();
-  if (!is_empty_io && !io_config.Find("name", &tmp)) {
-    return TRITONSERVER_ErrorNew(
-        TRITONSERVER_ERROR_INVALID_ARG,
-        (std::string("'name' is a required field for all inputs/outputs."))
-            .c_str());
-  }
+    RETURN_IF_ERROR(FillMissingValues(io, blank_value));
 
-  // If this I/O is empty then we are using the model
-  // to autocomplete.
-  if (is_empty_io) {
-    RETURN_IF_ERROR(io_config.SetStringObject("name", io->name_));
+    RETURN_IF_ERROR(ios.Append(std::move(blank_value)));
   }
+  reference_list_copy.clear();
 
-  bool found_config_data_type = io_config.Find("data_type", &tmp);
-  std::string data_type_str;
-  if (found_config_data_type) {
-    RETURN_IF_ERROR(tmp.AsString(&data_type_str));
-  }
-  bool should_auto_complete_data_type =
-      !found_config_data_type || DataTypeIsInvalid(data_type_str);
-  if (should_auto_complete_data_type) {
-    RETURN_IF_ERROR(io_config.SetStringObject(
-        "data_type", ConvertToModelConfigString(io->data_type_)));
-  }
+  return nullptr;  // success
+}
 
-  bool found_dims = io_config.Find("dims", &tmp);
-  bool should_auto_complete_dims = !found_dims || (tmp.ArraySize() == 0);
-  if (should_auto_complete_dims) {
-    RETURN_ERROR_IF_TRUE(
-        io->shape_->rank_ == 0, TRITONSERVER_ERROR_INVALID_ARG,
-        std::string(
-            "Unable to autofill for '" + model_state_->Name() +
-            "': the rank of model tensor '" + io->name_ +
-            "' is 0 and dimensions are not defined"));
-    // The model signature supports batching then the first
-    // dimension is -1 and should not appear in the model
-    // configuration 'dims' that we are creating.
-    triton::common::TritonJson::Value dims(
+TRITONSERVER_Error*
+AutoCompleteHelper::FixConfigOutputs(const TRITONTF_IOList* reference_list)
+{
+  triton::common::TritonJson::Value ios;
+  bool found_ios = model_state_->ModelConfig().Find("output", &ios);
+
+  // If output is empty or undefined then autocomplete this otherwise
+  // only check the defined outputs
+  bool should_auto_complete_output = (!found_ios || ios.ArraySize() == 0);
+  if (should_auto_complete_output) {
+    triton::common::TritonJson::Value auto_complete_ios(
         model_state_->ModelConfig(),
         triton::common::TritonJson::ValueType::ARRAY);
+    for (const TRITONTF_IOList* itr = reference_list; itr != nullptr;
+         itr = itr->next_) {
+      const TRITONTF_IO* io = itr->io_;
 
-    for (size_t i = (model_support_batching_ ? 1 : 0); i < io->shape_->rank_;
-         ++i) {
-      RETURN_IF_ERROR(dims.AppendInt(io->shape_->dims_[i]));
-    }
-    if (dims.ArraySize() == 0) {
-      RETURN_IF_ERROR(dims.AppendInt(1));
-      triton::common::TritonJson::Value reshape(
+      // Sequence state outputs are consumed by the backend.
+      bool is_state = false;
+      for (const auto& state : model_state_->SequenceStates()) {
+        is_state |= (state.output_name_ == io->name_);
+      }
+      if (is_state) {
+        continue;
+      }
+
+      triton::common::TritonJson::Value auto_complete_io(
           model_state_->ModelConfig(),
           triton::common::TritonJson::ValueType::OBJECT);
-      triton::common::TritonJson::Value reshape_dims(
+      RETURN_IF_ERROR(auto_complete_io.AddString("name", io->name_));
+      RETURN_IF_ERROR(auto_complete_io.AddString(
+          "data_type", ConvertToModelConfigString(io->data_type_)));
+      triton::common::TritonJson::Value dims(
           model_state_->ModelConfig(),
           triton::common::TritonJson::ValueType::ARRAY);
-      RETURN_IF_ERROR(reshape.Add("shape", std::move(reshape_dims)));
-      RETURN_IF_ERROR(io_config.Add("reshape", std::move(reshape)));
+      RETURN_ERROR_IF_TRUE(
+          io->shape_->rank_ == 0, TRITONSERVER_ERROR_INVALID_ARG,
+          std::string(
+              "Unable to autofill for '" + model_state_->Name() +
+              "': the rank of model tensor '" + io->name_ +
+              "' is 0 which is not supported"));
+      // The model signature supports batching then the first
+      // dimension is -1 and should not appear in the model
+      // configuration 'dims' that we are creating.
+      for (size_t i = (model_support_batching_ ? 1 : 0); i < io->shape_->rank_;
+           ++i) {
+        RETURN_IF_ERROR(dims.AppendInt(io->shape_->dims_[i]));
+      }
+
+      // If io dims are empty then must use a reshape for the
+      // io, since 'dims' is not allowed to be empty.
+      if (dims.ArraySize() == 0) {
+        RETURN_IF_ERROR(dims.AppendInt(1));
+        triton::common::TritonJson::Value reshape(
+            model_state_->ModelConfig(),
+            triton::common::TritonJson::ValueType::OBJECT);
+        triton::common::TritonJson::Value reshape_dims(
+            model_state_->ModelConfig(),
+            triton::common::TritonJson::ValueType::ARRAY);
+        RETURN_IF_ERROR(reshape.Add("shape", std::move(reshape_dims)));
+        RETURN_IF_ERROR(auto_complete_io.Add("reshape", std::move(reshape)));
+      }
+      RETURN_IF_ERROR(auto_complete_io.Add("dims", std::move(dims)));
+      RETURN_IF_ERROR(auto_complete_ios.Append(std::move(auto_complete_io)));
+    }
+    if (found_ios) {
+      ios.Swap(auto_complete_ios);
+    } else {
+      RETURN_IF_ERROR(model_state_->ModelConfig().Add(
+          "output", std::move(auto_complete_ios)));
     }
+  } else {
+    // Outputs not specified in the configuration will be ignored; hence,
+    // iterate over the config outputs and not all model outputs.
+    triton::common::TritonJson::Value current_io(
+        model_state_->ModelConfig(),
+        triton::common::TritonJson::ValueType::OBJECT);
+    for (size_t i = 0; i < ios.ArraySize(); ++i) {
+      RETURN_IF_ERROR(ios.IndexAsObject(i, &current_io));
 
-    if (found_dims) {
-      RETURN_IF_ERROR(io_config.Remove("dims"));
+      std::string output_name;
+      RETURN_IF_ERROR(current_io.MemberAsString("name", &output_name));
+
+      const TRITONTF_IO* io = FindIOByName(reference_list, output_name);
+      if (io == nullptr) {
+        continue;
+      }
+
+      FillMissingValues(io, current_io);
     }
-    RETURN_IF_ERROR(io_config.Add("dims", std::move(dims)));
-  }  // end of should_auto_complete_dims
+  }
 
-  return nullptr;  // Success
+  return nullptr;  // success
 }
 
-void
-AutoCompleteHelper::RemoveByName(
-    const char* name, std::vector<const TRITONTF_IOList*>& list)
+TRITONSERVER_Error*
+ModelState::AutoCompleteConfig()
 {
-  for (size_t i = 0; i < list.size(); ++i) {
-    const TRITONTF_IOList* current = list.at(i);
-    if (!strcmp(name, current->io_->name_)) {
-      list.erase(list.begin() + i);
-      return;
+  // Nothing to be filled for graphdef as the model itself does not
+  // provide information needed.
+  if (!is_graphdef_) {
+    // Attempt to auto-complete the config with first loaded model file.
+    // 'default_model_filename' is the first model file to try.
+    std::string default_model_filename;
+    RETURN_IF_ERROR(ModelConfig().MemberAsString(
+        "default_model_filename", &default_model_filename));
+
+    if (default_model_filename.empty()) {
+      default_model_filename = "model.savedmodel";
+    }
+
+    auto model_path = JoinPath(
+        {RepositoryPath(), std::to_string(Version()), default_model_filename});
+
+    TRITONTF_Model* tritontf_model = nullptr;
+    TRITONTF_Error* err = nullptr;
+
+    bool exists;
+    RETURN_IF_ERROR(FileExists(model_path, &exists));
+    if (exists) {
+      // Load model for autocomplete to read from.
+      err = TRITONTF_ModelCreateFromSavedModel(
+          &tritontf_model, Name().c_str(), model_path.c_str(),
+          TRITONTF_NO_GPU_DEVICE, num_intra_threads_, num_inter_threads_,
+          use_per_session_threads_, graph_tag_.c_str(), signature_def_.c_str(),
+          false /* has_graph_level */, 0 /* graph_level */,
+          backend_config_->allow_gpu_memory_growth_,
+          backend_config_->per_process_gpu_memory_fraction_,
+          backend_config_->allow_soft_placement_,
+          backend_config_->memory_limit_mb_, nullptr /* tftrt_config */,
+          false /* auto_mixed precision */);
+
+      if (err != nullptr) {
+        std::string msg((err->msg_ == nullptr) ? "<unknown>" : err->msg_);
+        TRITONTF_ErrorDelete(err);
+        return TRITONSERVER_ErrorNew(
+            TRITONSERVER_ERROR_INTERNAL,
+            (std::string("unable to auto-complete model configuration for '") +
+             Name() + "', failed to load model: " + msg)
+                .c_str());
+      }
+
+      auto ach = AutoCompleteHelper(this, tritontf_model);
+      RETURN_IF_ERROR(ach.Fix());
+      RETURN_IF_ERROR(SetModelConfig());
     }
   }
+
+  return nullptr;  // success
 }
 
-void
-AutoCompleteHelper::CopyList(
-    const TRITONTF_IOList* src, std::vector<const TRITONTF_IOList*>& dst)
-{
-  while (src != nullptr) {
-    dst.push_back(src);
-    src = src->next_;
+TRITONSERVER_Error*
+ModelState::ValidateModelConfig()
+{
+  // We have the json DOM for the model configuration...
+  triton::common::TritonJson::WriteBuffer buffer;
+  RETURN_IF_ERROR(ModelConfig().PrettyWrite(&buffer));
+  LOG_MESSAGE(
+      TRITONSERVER_LOG_VERBOSE,
+      (std::string("model configuration:\n") + buffer.Contents()).c_str());
+
+  bool has_ragged_input = false;
+  triton::common::TritonJson::Value ios;
+  RETURN_IF_ERROR(ModelConfig().MemberAsArray("input", &ios));
+  for (size_t i = 0; i < ios.ArraySize(); i++) {
+    triton::common::TritonJson::Value io;
+    RETURN_IF_ERROR(ios.IndexAsObject(i, &io));
+    std::string io_name;
+    RETURN_IF_ERROR(io.MemberAsString("name", &io_name));
+    has_ragged_input |= IsInputRagged(io_name);
+    // Check datatypes
+    std::string io_dtype;
+    RETURN_IF_ERROR(io.MemberAsString("data_type", &io_dtype));
+    RETURN_ERROR_IF_TRUE(
+        ConvertDataType(io_dtype) == TRITONTF_DataType::TRITONTF_TYPE_INVALID,
+        TRITONSERVER_ERROR_INVALID_ARG,
+        std::string("unsupported datatype '") + io_dtype + "' for tensor '" +
+            io_name + "' for model '" + Name() + "'");
+  }
+  RETURN_IF_ERROR(ModelConfig().MemberAsArray("output", &ios));
+  for (size_t i = 0; i < ios.ArraySize(); i++) {
+    triton::common::TritonJson::Value io;
+    RETURN_IF_ERROR(ios.IndexAsObject(i, &io));
+    std::string io_name;
+    RETURN_IF_ERROR(io.MemberAsString("name", &io_name));
+    config_output_names_.insert(io_name);
+    // Check datatypes
+    std::string io_dtype;
+    RETURN_IF_ERROR(io.MemberAsString("data_type", &io_dtype));
+    RETURN_ERROR_IF_TRUE(
+        ConvertDataType(io_dtype) == TRITONTF_DataType::TRITONTF_TYPE_INVALID,
+        TRITONSERVER_ERROR_INVALID_ARG,
+        std::string("unsupported datatype '") + io_dtype + "' for tensor '" +
+            io_name + "' for model '" + Name() + "'");
+  }
+
+  RETURN_ERROR_IF_TRUE(
+      !ragged_length_buckets_.empty() && !has_ragged_input,
+      TRITONSERVER_ERROR_INVALID_ARG,
+      std::string("parameter 'TF_RAGGED_LENGTH_BUCKETS' requires a ragged "
+                  "input for model '") +
+          Name() + "'");
+
+  // Micro-batches are formed by splitting every input along the batch
+  // dimension and the outputs are stitched back the same way, which
+  // doesn't hold for ragged inputs and batch inputs / outputs.
+  can_split_batch_ = (MaxBatchSize() > 0) && !has_ragged_input &&
+                     BatchInputs().empty() && BatchOutputs().empty();
+  if (micro_batch_count_ > 1) {
+    RETURN_ERROR_IF_TRUE(
+        MaxBatchSize() == 0, TRITONSERVER_ERROR_INVALID_ARG,
+        std::string("parameter 'TF_MICRO_BATCH_COUNT' requires batching "
+                    "support for model '") +
+            Name() + "'");
+    RETURN_ERROR_IF_TRUE(
+        has_ragged_input || !BatchInputs().empty() || !BatchOutputs().empty(),
+        TRITONSERVER_ERROR_INVALID_ARG,
+        std::string("parameter 'TF_MICRO_BATCH_COUNT' can't be used with "
+                    "ragged inputs, batch inputs or batch outputs for model "
+                    "'") +
+            Name() + "'");
   }
+
+  return nullptr;  // success
 }
 
-TRITONSERVER_Error*
-AutoCompleteHelper::FixConfigInputs(const TRITONTF_IOList* reference_list)
-{
-  // Replace I/O even if inputs / outputs are specified in config.
-  triton::common::TritonJson::Value ios;
-  model_state_->ModelConfig().Find("input", &ios);
+//
+// ModelInstanceState
+//
+// State associated with a model instance. An object of this class is
+// created and associated with each TRITONBACKEND_ModelInstance.
+//
+class ModelInstanceState : public BackendModelInstance {
+ public:
+  static TRITONSERVER_Error* Create(
+      ModelState* model_state,
+      TRITONBACKEND_ModelInstance* triton_model_instance,
+      ModelInstanceState** state);
+  virtual ~ModelInstanceState();
 
-  // Iterate through the model config inputs and keep track of
-  // the ones which we found in the model. Any inputs left in the
-  // model list, we will attempt to autocomplete after. In the
-  // event there is an input which is in the model config but
-  // not in the model, we defer this check till later.
-  std::vector<const TRITONTF_IOList*> reference_list_copy;
-  CopyList(reference_list, reference_list_copy);
+  // Get the state of the model that corresponds to this instance.
+  ModelState* StateForModel() const { return model_state_; }
 
-  triton::common::TritonJson::Value current_io(
-      model_state_->ModelConfig(),
-      triton::common::TritonJson::ValueType::OBJECT);
-  for (size_t i = 0; i < ios.ArraySize(); ++i) {
-    RETURN_IF_ERROR(ios.IndexAsObject(i, &current_io));
+  // Respond to and release the requests that have been cancelled.
+  // The requests that should still be executed are returned in
+  // 'active_requests'.
+  void RemoveCancelledRequests(
+      TRITONBACKEND_Request** requests, const uint32_t request_count,
+      std::vector<TRITONBACKEND_Request*>* active_requests);
+
+  // Split the requests by the signature they select with the
+  // 'signature' request parameter, the empty signature being the one
+  // the model was created with. Requests that select a signature the
+  // model doesn't serve, or inputs or outputs that the signature
+  // doesn't have, are responded to with an error and released.
+  void GroupRequestsBySignature(
+      TRITONBACKEND_Request** requests, const uint32_t request_count,
+      std::map<std::string, std::vector<TRITONBACKEND_Request*>>* groups);
+
+  // Split the requests into sub-batches by the length bucket of their
+  // ragged inputs, in increasing order of length, so that a model that
+  // pads its inputs to the longest request doesn't pad short requests
+  // to the length of a long one. The length of a request is the
+  // largest element count of its ragged inputs. All the requests form
+  // a single sub-batch if the model has no length buckets.
+  void SplitRequestsByLength(
+      TRITONBACKEND_Request** requests, const uint32_t request_count,
+      std::vector<std::vector<TRITONBACKEND_Request*>>* sub_batches);
+
+  // Run the requests, all of which select signature 'signature'.
+  void ProcessRequests(
+      TRITONBACKEND_Request** requests, const uint32_t request_count,
+      const std::string& signature);
 
-    triton::common::TritonJson::Value current_name(
-        model_state_->ModelConfig(),
-        triton::common::TritonJson::ValueType::OBJECT);
-    std::string config_name;
-    RETURN_IF_ERROR(current_io.MemberAsString("name", &config_name));
+  // Guards the model of the instance against the idle session
+  // reaper. Held for the whole execution.
+  std::mutex& ModelMutex() { return model_mu_; }
 
-    const TRITONTF_IO* io = FindIOByName(reference_list_copy, config_name);
-    if (io == nullptr) {
-      continue;
-    }
+  // Get the model of the instance, creating it if it wasn't created
+  // yet or was released while idle, and mark the instance as active.
+  // The caller must hold ModelMutex().
+  TRITONSERVER_Error* AcquireModel();
 
-    RETURN_IF_ERROR(FillMissingValues(io, current_io));
+  // Mark the instance as active at 'now_ns'. The caller must hold
+  // ModelMutex().
+  void MarkActive(const uint64_t now_ns) { last_active_ns_ = now_ns; }
 
-    RemoveByName(io->name_, reference_list_copy);
+ private:
+  ModelInstanceState(
+      ModelState* model_state,
+      TRITONBACKEND_ModelInstance* triton_model_instance);
+
+  // Feed the backend-owned sequence state of each request as the
+  // state inputs of the batch. Requests that start a sequence, or
+  // whose state is not known, are fed a zero state.
+  TRITONSERVER_Error* SetSequenceStateInputs(
+      TRITONBACKEND_Request** requests, const uint32_t request_count,
+      const std::vector<size_t>& request_batch_sizes,
+      const size_t total_batch_size, TRITONTF_TensorList** input_tensors,
+      bool* cuda_copy);
+
+  // Keep the state outputs of each successful request so that they
+  // can be fed to the next request of the same sequence.
+  bool SaveSequenceStateOutputs(
+      TRITONBACKEND_Request** requests, const uint32_t request_count,
+      const std::vector<TRITONBACKEND_Response*>& responses,
+      const std::vector<size_t>& request_batch_sizes,
+      const std::unordered_map<std::string, TRITONTF_Tensor*>&
+          output_tensors);
+
+  // Release the state of the sequences that have been idle for longer
+  // than the sequence idle timeout.
+  void EvictIdleSequenceStates();
+
+  // Copy input 'name' of each request, whose shape is in
+  // 'request_shapes', into the padded batch tensor 'tensor' of shape
+  // 'batchn_shape' and fill the rest of the tensor with 'pad_value'.
+  // Requests with an empty shape have already been responded to.
+  void SetPaddedInputTensor(
+      TRITONBACKEND_Request** requests, const uint32_t request_count,
+      std::vector<TRITONBACKEND_Response*>* responses,
+      const std::vector<size_t>& request_batch_sizes, const char* name,
+      const TRITONSERVER_DataType datatype,
+      const std::vector<std::vector<int64_t>>& request_shapes,
+      const std::vector<int64_t>& batchn_shape, const double pad_value,
+      TRITONTF_Tensor* tensor);
+
+  // Copy input 'name' of the request, whose first dimension has size
+  // 1, into every row of 'tensor', whose first dimension has the size
+  // of the reference input. Returns true if a CUDA copy was issued.
+  bool SetBroadcastInputTensor(
+      TRITONBACKEND_Request* request, TRITONBACKEND_Response** response,
+      const char* name, const std::vector<int64_t>& batchn_shape,
+      TRITONTF_Tensor* tensor);
+
+  // Respond with output 'name' of 'output_tensor' cropped, for each
+  // request, to the request shape of the padded input that the output
+  // follows. 'request_shapes' are the request shapes of the padded
+  // input and 'input_shape' its padded batch shape. An output
+  // dimension is cropped if it has the padded size of the input
+  // dimension at the same position. Returns true if a CUDA copy was
+  // issued.
+  bool SetCroppedOutput(
+      TRITONBACKEND_Request** requests, const uint32_t request_count,
+      std::vector<TRITONBACKEND_Response*>* responses,
+      const std::vector<std::set<std::string>>& request_required_outputs,
+      const std::vector<size_t>& request_batch_sizes, const std::string& name,
+      TRITONTF_Tensor* output_tensor,
+      const std::vector<std::vector<int64_t>>& request_shapes,
+      const std::vector<int64_t>& input_shape);
+
+  // Get the CPUs and the NUMA node the instance is bound to. The
+  // 'cpu-cores' and 'numa-node' settings of the host policy of the
+  // instance take precedence over the model parameters.
+  TRITONSERVER_Error* GetAffinity(std::vector<int>* cpus, int* numa_node);
+
+  // Release the model of the instance if the instance has been idle
+  // for longer than the session idle timeout at 'now_ns'. Skipped if
+  // the instance is executing.
+  void ReleaseIdleModel(const uint64_t now_ns);
+
+  ModelState* model_state_;
+  // Model for this context, created on demand when the model sets
+  // 'TF_LAZY_SESSION' or 'TF_SESSION_IDLE_TIMEOUT_MS'.
+  ModelState::Model model_;
+  std::mutex model_mu_;
+  // Whether 'model_' was released while idle.
+  bool released_;
+  // The model file and the device of the model.
+  std::string model_path_;
+  int gpu_device_;
+  uint64_t last_active_ns_;
+  // Thread pools to run the model with, nullptr if the model session
+  // thread pools are used.
+  std::shared_ptr<TRITONTF_ThreadPools> thread_pools_;
+  // NUMA node for the input tensors, -1 if there is no preference.
+  int numa_node_;
+
+  // Temporary buffers of an execution, reused across executions.
+  ScratchArena scratch_arena_;
+
+  // Whether the model has been run by this instance. TensorFlow
+  // optimizes the graph of a run signature on its first run.
+  bool has_run_;
+
+  // Whether the input shape signatures of the runs are tracked, which
+  // is only done for the CPU instances when oneDNN is in use.
+  bool track_shapes_;
+  // The most recent input shape signatures of the runs.
+  ShapeSignatureCache shape_cache_;
+
+  // The sequence state of each in-flight sequence, keyed by the
+  // correlation ID of the sequence. The tensor list holds one tensor
+  // for each state in the order of ModelState::SequenceStates().
+  struct SequenceStateSlot {
+    SequenceStateSlot() : tensors_(nullptr, TRITONTF_TensorListDelete) {}
+    std::unique_ptr<TRITONTF_TensorList, decltype(&TRITONTF_TensorListDelete)>
+        tensors_;
+    uint64_t last_access_ns_;
+  };
+  std::unordered_map<std::string, SequenceStateSlot> sequence_states_;
+};
+
+TRITONSERVER_Error*
+ModelInstanceState::Create(
+    ModelState* model_state, TRITONBACKEND_ModelInstance* triton_model_instance,
+    ModelInstanceState** state)
+{
+  try {
+    *state = new ModelInstanceState(model_state, triton_model_instance);
+  }
+  catch (const BackendModelInstanceException& ex) {
+    RETURN_ERROR_IF_TRUE(
+        ex.err_ == nullptr, TRITONSERVER_ERROR_INTERNAL,
+        std::string("unexpected nullptr in BackendModelInstanceException"));
+    RETURN_IF_ERROR(ex.err_);
   }
 
-  // Ragged batching can have batch_input which are inputs in the
-  // the model config. Unfortunately these cannot autocomplete,
-  // so just check them off so they're not duplicated.
-  triton::common::TritonJson::Value batch_inputs(
-      model_state_->ModelConfig(),
-      triton::common::TritonJson::ValueType::ARRAY);
-  model_state_->ModelConfig().Find("batch_input", &batch_inputs);
-  for (size_t i = 0; i < batch_inputs.ArraySize(); ++i) {
-    RETURN_IF_ERROR(batch_inputs.IndexAsObject(i, &current_io));
+  // If the model configuration doesn't have an explicit model file
+  // specified then use the default name.
+  std::string cc_model_filename = (*state)->ArtifactFilename();
+  if (cc_model_filename.empty()) {
+    if (model_state->IsGraphdef()) {
+      cc_model_filename = "model.graphdef";
+    } else {
+      cc_model_filename = "model.savedmodel";
+    }
+  }
 
-    triton::common::TritonJson::Value target_names(
-        model_state_->ModelConfig(),
-        triton::common::TritonJson::ValueType::ARRAY);
-    RETURN_IF_ERROR(current_io.MemberAsArray("target_name", &target_names));
+  auto model_path = JoinPath(
+      {model_state->RepositoryPath(), std::to_string(model_state->Version()),
+       cc_model_filename});
 
-    std::string current_name_str;
-    for (size_t j = 0; j < target_names.ArraySize(); ++j) {
-      RETURN_IF_ERROR(target_names.IndexAsString(j, &current_name_str));
+  {
+    bool exists;
+    RETURN_IF_ERROR(FileExists(model_path, &exists));
+    RETURN_ERROR_IF_FALSE(
+        exists, TRITONSERVER_ERROR_UNAVAILABLE,
+        std::string("unable to find '") + model_path +
+            "' for model instance '" + (*state)->Name() + "'");
+  }
 
-      const TRITONTF_IO* io =
-          FindIOByName(reference_list_copy, current_name_str);
-      if (io == nullptr) {
-        continue;
-      }
+  int gpu_device;
+  switch ((*state)->Kind()) {
+    case TRITONSERVER_INSTANCEGROUPKIND_CPU:
+      gpu_device = ModelState::NO_GPU_DEVICE;
+      break;
+    case TRITONSERVER_INSTANCEGROUPKIND_MODEL:
+      gpu_device = ModelState::MODEL_DEVICE;
+      break;
+    default:
+      gpu_device = (*state)->DeviceId();
+      break;
+  }
 
-      RemoveByName(io->name_, reference_list_copy);
-    }
+  (*state)->model_path_ = model_path;
+  (*state)->gpu_device_ = gpu_device;
+  if (!model_state->LazySession()) {
+    std::lock_guard<std::mutex> lock((*state)->model_mu_);
+    RETURN_IF_ERROR((*state)->AcquireModel());
+  }
+  std::vector<int> cpus;
+  RETURN_IF_ERROR((*state)->GetAffinity(&cpus, &(*state)->numa_node_));
+  RETURN_IF_ERROR(model_state->GetThreadPools(
+      (*state)->Name(), cpus, (*state)->numa_node_, &(*state)->thread_pools_));
+
+  if (model_state->SessionIdleTimeoutNs() > 0) {
+    ModelInstanceState* instance = *state;
+    model_state->RegisterIdleSessionCheck(
+        instance,
+        [instance](uint64_t now_ns) { instance->ReleaseIdleModel(now_ns); });
   }
 
-  // Sequence_batching::control_input cannot be autocompleted, check off the
-  // names the same as ragged batching
-  triton::common::TritonJson::Value sequence_batching;
-  bool found_sequence_batching =
-      model_state_->ModelConfig().Find("sequence_batching", &sequence_batching);
-  if (found_sequence_batching) {
-    triton::common::TritonJson::Value control_inputs(
-        model_state_->ModelConfig(),
-        triton::common::TritonJson::ValueType::ARRAY);
-    sequence_batching.Find("control_input", &control_inputs);
-    for (size_t i = 0; i < control_inputs.ArraySize(); ++i) {
-      RETURN_IF_ERROR(control_inputs.IndexAsObject(i, &current_io));
+  return nullptr;  // success
+}
 
-      std::string name;
-      RETURN_IF_ERROR(current_io.MemberAsString("name", &name));
+ModelInstanceState::ModelInstanceState(
+    ModelState* model_state, TRITONBACKEND_ModelInstance* triton_model_instance)
+    : BackendModelInstance(model_state, triton_model_instance),
+      model_state_(model_state), released_(false),
+      gpu_device_(ModelState::NO_GPU_DEVICE),
+      last_active_ns_(0), numa_node_(-1), has_run_(false),
+      track_shapes_(
+          (Kind() == TRITONSERVER_INSTANCEGROUPKIND_CPU) &&
+          TRITONTF_OneDNNEnabled()),
+      shape_cache_(kShapeSignatureCacheCapacity)
+{
+}
 
-      const TRITONTF_IO* io = FindIOByName(reference_list_copy, name);
-      if (io == nullptr) {
-        continue;
-      }
+ModelInstanceState::~ModelInstanceState()
+{
+  model_state_->UnregisterIdleSessionCheck(this);
+  if (track_shapes_) {
+    LOG_MESSAGE(
+        TRITONSERVER_LOG_INFO,
+        (std::string("input shape signatures of '") + Name() + "': " +
+         std::to_string(shape_cache_.Hits()) + " runs with recent shapes, " +
+         std::to_string(shape_cache_.Misses()) + " runs with new shapes")
+            .c_str());
+  }
+}
 
-      RemoveByName(io->name_, reference_list_copy);
-    }
+TRITONSERVER_Error*
+ModelInstanceState::AcquireModel()
+{
+  if (model_.tritontf_model_ == nullptr) {
+    RETURN_IF_ERROR(model_state_->GetModel(
+        gpu_device_, model_path_, released_, &model_));
+    released_ = false;
   }
+  MarkActive(SteadyClockNs());
+  return nullptr;  // success
+}
 
-  // Adding configuration from inputs detected in the loaded model
-  // but not found in the model configuration.
-  for (size_t i = 0; i < reference_list_copy.size(); ++i) {
-    const TRITONTF_IOList* current = reference_list_copy.at(i);
-    TRITONTF_IO* io = current->io_;
+void
+ModelInstanceState::ReleaseIdleModel(const uint64_t now_ns)
+{
+  std::unique_lock<std::mutex> lock(model_mu_, std::try_to_lock);
+  if (!lock.owns_lock() || (model_.tritontf_model_ == nullptr) ||
+      ((now_ns - last_active_ns_) < model_state_->SessionIdleTimeoutNs())) {
+    return;
+  }
 
-    triton::common::TritonJson::Value blank_value(
-        model_state_->ModelConfig(),
-        triton::common::TritonJson::ValueType::OBJECT);
+  model_state_->ReleaseModel(gpu_device_, model_);
+  model_ = ModelState::Model();
+  released_ = true;
+  // The session is created again on the next execution, which
+  // optimizes the graph again on its first run.
+  has_run_ = false;
+  TrimHeap();
+  LOG_MESSAGE(
+      TRITONSERVER_LOG_INFO,
+      (std::string("released the idle session of '") + Name() + "'").c_str());
+}
 
-    RETURN_IF_ERROR(FillMissingValues(io, blank_value));
+TRITONSERVER_Error*
+ModelInstanceState::GetAffinity(std::vector<int>* cpus, int* numa_node)
+{
+  std::string cpu_cores = StateForModel()->CpuCores();
+  *numa_node = StateForModel()->NumaNode();
 
-    RETURN_IF_ERROR(ios.Append(std::move(blank_value)));
+  TRITONSERVER_Message* host_policy_message;
+  RETURN_IF_ERROR(TRITONBACKEND_ModelInstanceHostPolicy(
+      TritonModelInstance(), &host_policy_message));
+  const char* buffer;
+  size_t byte_size;
+  RETURN_IF_ERROR(TRITONSERVER_MessageSerializeToJson(
+      host_policy_message, &buffer, &byte_size));
+  triton::common::TritonJson::Value host_policies;
+  RETURN_IF_ERROR(host_policies.Parse(buffer, byte_size));
+  triton::common::TritonJson::Value host_policy;
+  if (host_policies.Find(HostPolicyName().c_str(), &host_policy)) {
+    triton::common::TritonJson::Value setting;
+    if (host_policy.Find("cpu-cores", &setting)) {
+      RETURN_IF_ERROR(setting.AsString(&cpu_cores));
+    }
+    if (host_policy.Find("numa-node", &setting)) {
+      std::string numa_node_str;
+      RETURN_IF_ERROR(setting.AsString(&numa_node_str));
+      RETURN_IF_ERROR(ParseIntValue(numa_node_str, numa_node));
+    }
   }
-  reference_list_copy.clear();
 
-  return nullptr;  // success
+  return ParseCpuList(cpu_cores, cpus);
 }
 
 TRITONSERVER_Error*
-AutoCompleteHelper::FixConfigOutputs(const TRITONTF_IOList* reference_list)
+ModelInstanceState::SetSequenceStateInputs(
+    TRITONBACKEND_Request** requests, const uint32_t request_count,
+    const std::vector<size_t>& request_batch_sizes,
+    const size_t total_batch_size, TRITONTF_TensorList** input_tensors,
+    bool* cuda_copy)
 {
-  triton::common::TritonJson::Value ios;
-  bool found_ios = model_state_->ModelConfig().Find("output", &ios);
+  const auto& states = StateForModel()->SequenceStates();
+  const bool supports_batching = (StateForModel()->MaxBatchSize() > 0);
+  const uint64_t now_ns = SteadyClockNs();
 
-  // If output is empty or undefined then autocomplete this otherwise
-  // only check the defined outputs
-  bool should_auto_complete_output = (!found_ios || ios.ArraySize() == 0);
-  if (should_auto_complete_output) {
-    triton::common::TritonJson::Value auto_complete_ios(
-        model_state_->ModelConfig(),
-        triton::common::TritonJson::ValueType::ARRAY);
-    for (const TRITONTF_IOList* itr = reference_list; itr != nullptr;
-         itr = itr->next_) {
-      const TRITONTF_IO* io = itr->io_;
+  // Find the stored state of each request. The state of a sequence
+  // restarts when a new sequence begins with the same correlation ID.
+  std::vector<SequenceStateSlot*> slots(request_count, nullptr);
+  for (uint32_t r = 0; r < request_count; ++r) {
+    uint32_t flags = 0;
+    RETURN_IF_ERROR(TRITONBACKEND_RequestFlags(requests[r], &flags));
+    std::string key;
+    RETURN_IF_ERROR(GetSequenceKey(requests[r], &key));
+    if ((flags & TRITONSERVER_REQUEST_FLAG_SEQUENCE_START) != 0) {
+      sequence_states_.erase(key);
+      continue;
+    }
 
-      triton::common::TritonJson::Value auto_complete_io(
-          model_state_->ModelConfig(),
-          triton::common::TritonJson::ValueType::OBJECT);
-      RETURN_IF_ERROR(auto_complete_io.AddString("name", io->name_));
-      RETURN_IF_ERROR(auto_complete_io.AddString(
-          "data_type", ConvertToModelConfigString(io->data_type_)));
-      triton::common::TritonJson::Value dims(
-          model_state_->ModelConfig(),
-          triton::common::TritonJson::ValueType::ARRAY);
-      RETURN_ERROR_IF_TRUE(
-          io->shape_->rank_ == 0, TRITONSERVER_ERROR_INVALID_ARG,
-          std::string(
-              "Unable to autofill for '" + model_state_->Name() +
-              "': the rank of model tensor '" + io->name_ +
-              "' is 0 which is not supported"));
-      // The model signature supports batching then the first
-      // dimension is -1 and should not appear in the model
-      // configuration 'dims' that we are creating.
-      for (size_t i = (model_support_batching_ ? 1 : 0); i < io->shape_->rank_;
-           ++i) {
-        RETURN_IF_ERROR(dims.AppendInt(io->shape_->dims_[i]));
-      }
+    auto it = sequence_states_.find(key);
+    if (it != sequence_states_.end()) {
+      it->second.last_access_ns_ = now_ns;
+      slots[r] = &it->second;
+    }
+  }
 
-      // If io dims are empty then must use a reshape for the
-      // io, since 'dims' is not allowed to be empty.
-      if (dims.ArraySize() == 0) {
-        RETURN_IF_ERROR(dims.AppendInt(1));
-        triton::common::TritonJson::Value reshape(
-            model_state_->ModelConfig(),
-            triton::common::TritonJson::ValueType::OBJECT);
-        triton::common::TritonJson::Value reshape_dims(
-            model_state_->ModelConfig(),
-            triton::common::TritonJson::ValueType::ARRAY);
-        RETURN_IF_ERROR(reshape.Add("shape", std::move(reshape_dims)));
-        RETURN_IF_ERROR(auto_complete_io.Add("reshape", std::move(reshape)));
-      }
-      RETURN_IF_ERROR(auto_complete_io.Add("dims", std::move(dims)));
-      RETURN_IF_ERROR(auto_complete_ios.Append(std::move(auto_complete_io)));
+  for (size_t i = 0; i < states.size(); ++i) {
+    const auto& state = states[i];
+
+    std::vector<int64_t> batchn_shape;
+    if (supports_batching) {
+      batchn_shape.push_back(total_batch_size);
+    }
+    batchn_shape.insert(
+        batchn_shape.end(), state.dims_.begin(), state.dims_.end());
+
+    // The name of the input in the model can be different...
+    const char* input_tensor_name = state.input_name_.c_str();
+    const auto& tn_itr = model_.input_name_map_.find(state.input_name_);
+    if (tn_itr != model_.input_name_map_.end()) {
+      input_tensor_name = tn_itr->second.c_str();
     }
-    if (found_ios) {
-      ios.Swap(auto_complete_ios);
-    } else {
-      RETURN_IF_ERROR(model_state_->ModelConfig().Add(
-          "output", std::move(auto_complete_ios)));
+
+    TRITONTF_Tensor* tensor = TRITONTF_TensorNew(
+        input_tensor_name, ConvertDataType(state.datatype_),
+        batchn_shape.size(), batchn_shape.data(), model_.input_device_id_,
+        numa_node_);
+    if (tensor == nullptr) {
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INTERNAL,
+          (std::string("failed to create sequence state tensor '") +
+           state.input_name_ + "' with shape " +
+           ShapeToString(batchn_shape) + " for '" + Name() + "'")
+              .c_str());
     }
-  } else {
-    // Outputs not specified in the configuration will be ignored; hence,
-    // iterate over the config outputs and not all model outputs.
-    triton::common::TritonJson::Value current_io(
-        model_state_->ModelConfig(),
-        triton::common::TritonJson::ValueType::OBJECT);
-    for (size_t i = 0; i < ios.ArraySize(); ++i) {
-      RETURN_IF_ERROR(ios.IndexAsObject(i, &current_io));
+    *input_tensors = TRITONTF_TensorListNew(tensor, *input_tensors);
 
-      std::string output_name;
-      RETURN_IF_ERROR(current_io.MemberAsString("name", &output_name));
+    const TRITONSERVER_MemoryType dst_memory_type =
+        TRITONTF_TensorIsGPUTensor(tensor) ? TRITONSERVER_MEMORY_GPU
+                                           : TRITONSERVER_MEMORY_CPU;
+    const int64_t dst_memory_type_id =
+        TRITONTF_TensorIsGPUTensor(tensor) ? DeviceId() : 0;
+    const size_t row_byte_size = GetByteSize(state.datatype_, state.dims_);
 
-      const TRITONTF_IO* io = FindIOByName(reference_list, output_name);
-      if (io == nullptr) {
-        continue;
+    size_t offset = 0;
+    for (uint32_t r = 0; r < request_count; ++r) {
+      const size_t byte_size = row_byte_size * request_batch_sizes[r];
+
+      TRITONTF_Tensor* saved = nullptr;
+      if (slots[r] != nullptr) {
+        TRITONTF_TensorList* itr = slots[r]->tensors_.get();
+        for (size_t j = 0; (j < i) && (itr != nullptr); ++j) {
+          itr = itr->next_;
+        }
+        saved = (itr != nullptr) ? itr->tensor_ : nullptr;
       }
 
-      FillMissingValues(io, current_io);
+      if ((saved != nullptr) &&
+          (TRITONTF_TensorDataByteSize(saved) == byte_size)) {
+        bool cuda_used = false;
+        RETURN_IF_ERROR(CopyBuffer(
+            "Sequence state input",
+            TRITONTF_TensorIsGPUTensor(saved) ? TRITONSERVER_MEMORY_GPU
+                                              : TRITONSERVER_MEMORY_CPU,
+            TRITONTF_TensorIsGPUTensor(saved) ? DeviceId() : 0,
+            dst_memory_type, dst_memory_type_id, byte_size,
+            TRITONTF_TensorData(saved), TRITONTF_TensorData(tensor) + offset,
+            CudaStream(), &cuda_used));
+        *cuda_copy |= cuda_used;
+      } else {
+        *cuda_copy |=
+            ZeroTensorRegion(tensor, offset, byte_size, CudaStream());
+      }
+
+      offset += byte_size;
     }
   }
 
   return nullptr;  // success
 }
 
-TRITONSERVER_Error*
-ModelState::AutoCompleteConfig()
+bool
+ModelInstanceState::SaveSequenceStateOutputs(
+    TRITONBACKEND_Request** requests, const uint32_t request_count,
+    const std::vector<TRITONBACKEND_Response*>& responses,
+    const std::vector<size_t>& request_batch_sizes,
+    const std::unordered_map<std::string, TRITONTF_Tensor*>& output_tensors)
 {
-  // Nothing to be filled for graphdef as the model itself does not
-  // provide information needed.
-  if (!is_graphdef_) {
-    // Attempt to auto-complete the config with first loaded model file.
-    // 'default_model_filename' is the first model file to try.
-    std::string default_model_filename;
-    RETURN_IF_ERROR(ModelConfig().MemberAsString(
-        "default_model_filename", &default_model_filename));
+  bool cuda_copy = false;
+  const auto& states = StateForModel()->SequenceStates();
+  const bool supports_batching = (StateForModel()->MaxBatchSize() > 0);
+  const uint64_t now_ns = SteadyClockNs();
 
-    if (default_model_filename.empty()) {
-      default_model_filename = "model.savedmodel";
+  size_t total_rows = 0;
+  for (const auto rows : request_batch_sizes) {
+    total_rows += rows;
+  }
+
+  std::vector<TRITONTF_Tensor*> state_outputs;
+  for (const auto& state : states) {
+    const auto itr = output_tensors.find(state.output_name_);
+    if (itr == output_tensors.end()) {
+      LOG_MESSAGE(
+          TRITONSERVER_LOG_ERROR,
+          (std::string("sequence state output '") + state.output_name_ +
+           "' is not produced for '" + Name() + "'")
+              .c_str());
+      return cuda_copy;
     }
+    state_outputs.push_back(itr->second);
+  }
 
-    auto model_path = JoinPath(
-        {RepositoryPath(), std::to_string(Version()), default_model_filename});
+  size_t row_offset = 0;
+  for (uint32_t r = 0; r < request_count; ++r) {
+    const size_t rows = request_batch_sizes[r];
+    const size_t start_row = row_offset;
+    row_offset += rows;
 
-    TRITONTF_Model* tritontf_model = nullptr;
-    TRITONTF_Error* err = nullptr;
+    // Requests that failed do not advance the state of their sequence.
+    if (responses[r] == nullptr) {
+      continue;
+    }
 
-    bool exists;
-    RETURN_IF_ERROR(FileExists(model_path, &exists));
-    if (exists) {
-      // Load model for autocomplete to read from.
-      err = TRITONTF_ModelCreateFromSavedModel(
-          &tritontf_model, Name().c_str(), model_path.c_str(),
-          TRITONTF_NO_GPU_DEVICE, num_intra_threads_, num_inter_threads_,
-          use_per_session_threads_, graph_tag_.c_str(), signature_def_.c_str(),
-          false /* has_graph_level */, 0 /* graph_level */,
-          backend_config_->allow_gpu_memory_growth_,
-          backend_config_->per_process_gpu_memory_fraction_,
-          backend_config_->allow_soft_placement_,
-          backend_config_->memory_limit_mb_, nullptr /* tftrt_config */,
-          false /* auto_mixed precision */);
+    uint32_t flags = 0;
+    std::string key;
+    auto err = TRITONBACKEND_RequestFlags(requests[r], &flags);
+    if (err == nullptr) {
+      err = GetSequenceKey(requests[r], &key);
+    }
+    if (err != nullptr) {
+      LOG_IF_ERROR(err, "failed to identify sequence of request");
+      continue;
+    }
+
+    // The state is no longer needed once the sequence ends.
+    if ((flags & TRITONSERVER_REQUEST_FLAG_SEQUENCE_END) != 0) {
+      sequence_states_.erase(key);
+      continue;
+    }
 
+    TRITONTF_TensorList* tensors = nullptr;
+    bool success = true;
+    for (size_t i = states.size(); success && (i-- > 0);) {
+      TRITONTF_Tensor* output = state_outputs[i];
+      const TRITONTF_Shape* output_shape = TRITONTF_TensorShape(output);
+      std::vector<int64_t> shape(
+          output_shape->dims_, output_shape->dims_ + output_shape->rank_);
+      const size_t row_byte_size =
+          (supports_batching && (total_rows != 0))
+              ? TRITONTF_TensorDataByteSize(output) / total_rows
+              : TRITONTF_TensorDataByteSize(output);
+      if (supports_batching && !shape.empty()) {
+        shape[0] = rows;
+      }
+
+      TRITONTF_Tensor* tensor = TRITONTF_TensorNew(
+          states[i].input_name_.c_str(), TRITONTF_TensorDataType(output),
+          shape.size(), shape.empty() ? nullptr : shape.data(),
+          model_.input_device_id_, numa_node_);
+      if (tensor == nullptr) {
+        success = false;
+        break;
+      }
+      tensors = TRITONTF_TensorListNew(tensor, tensors);
+
+      bool cuda_used = false;
+      err = CopyBuffer(
+          "Sequence state output",
+          TRITONTF_TensorIsGPUTensor(output) ? TRITONSERVER_MEMORY_GPU
+                                             : TRITONSERVER_MEMORY_CPU,
+          TRITONTF_TensorIsGPUTensor(output) ? DeviceId() : 0,
+          TRITONTF_TensorIsGPUTensor(tensor) ? TRITONSERVER_MEMORY_GPU
+                                             : TRITONSERVER_MEMORY_CPU,
+          TRITONTF_TensorIsGPUTensor(tensor) ? DeviceId() : 0,
+          TRITONTF_TensorDataByteSize(tensor),
+          TRITONTF_TensorData(output) + (start_row * row_byte_size),
+          TRITONTF_TensorData(tensor), CudaStream(), &cuda_used);
+      cuda_copy |= cuda_used;
       if (err != nullptr) {
-        std::string msg((err->msg_ == nullptr) ? "<unknown>" : err->msg_);
-        TRITONTF_ErrorDelete(err);
-        return TRITONSERVER_ErrorNew(
-            TRITONSERVER_ERROR_INTERNAL,
-            (std::string("unable to auto-complete model configuration for '") +
-             Name() + "', failed to load model: " + msg)
-                .c_str());
+        LOG_IF_ERROR(err, "failed to save sequence state");
+        success = false;
       }
+    }
 
-      auto ach = AutoCompleteHelper(this, tritontf_model);
-      RETURN_IF_ERROR(ach.Fix());
-      RETURN_IF_ERROR(SetModelConfig());
+    if (success) {
+      auto& slot = sequence_states_[key];
+      slot.tensors_.reset(tensors);
+      slot.last_access_ns_ = now_ns;
+    } else {
+      TRITONTF_TensorListDelete(tensors);
+      sequence_states_.erase(key);
+      LOG_MESSAGE(
+          TRITONSERVER_LOG_ERROR,
+          (std::string("failed to save sequence state for '") + Name() +
+           "', the sequence will restart from the initial state")
+              .c_str());
     }
   }
 
-  return nullptr;  // success
+  return cuda_copy;
 }
 
-TRITONSERVER_Error*
-ModelState::ValidateModelConfig()
+void
+ModelInstanceState::EvictIdleSequenceStates()
 {
-  // We have the json DOM for the model configuration...
-  triton::common::TritonJson::WriteBuffer buffer;
-  RETURN_IF_ERROR(ModelConfig().PrettyWrite(&buffer));
-  LOG_MESSAGE(
-      TRITONSERVER_LOG_VERBOSE,
-      (std::string("model configuration:\n") + buffer.Contents()).c_str());
+  const uint64_t now_ns = SteadyClockNs();
+  const uint64_t timeout_ns = StateForModel()->SequenceIdleTimeoutNs();
+  for (auto it = sequence_states_.begin(); it != sequence_states_.end();) {
+    if ((now_ns - it->second.last_access_ns_) > timeout_ns) {
+      LOG_MESSAGE(
+          TRITONSERVER_LOG_VERBOSE,
+          (std::string("releasing state of idle sequence ") + it->first +
+           " for '" + Name() + "'")
+              .c_str());
+      it = sequence_states_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
 
-  triton::common::TritonJson::Value ios;
-  RETURN_IF_ERROR(ModelConfig().MemberAsArray("input", &ios));
-  for (size_t i = 0; i < ios.ArraySize(); i++) {
-    triton::common::TritonJson::Value io;
-    RETURN_IF_ERROR(ios.IndexAsObject(i, &io));
-    std::string io_name;
-    RETURN_IF_ERROR(io.MemberAsString("name", &io_name));
-    // Check datatypes
-    std::string io_dtype;
-    RETURN_IF_ERROR(io.MemberAsString("data_type", &io_dtype));
-    RETURN_ERROR_IF_TRUE(
-        ConvertDataType(io_dtype) == TRITONTF_DataType::TRITONTF_TYPE_INVALID,
-        TRITONSERVER_ERROR_INVALID_ARG,
-        std::string("unsupported datatype '") + io_dtype + "' for tensor '" +
-            io_name + "' for model '" + Name() + "'");
+void
+ModelInstanceState::RemoveCancelledRequests(
+    TRITONBACKEND_Request** requests, const uint32_t request_count,
+    std::vector<TRITONBACKEND_Request*>* active_requests)
+{
+  active_requests->clear();
+  active_requests->reserve(request_count);
+  for (uint32_t r = 0; r < request_count; ++r) {
+    // A nullptr request is reported by ProcessRequests
+    bool is_cancelled = false;
+    if (requests[r] != nullptr) {
+      LOG_IF_ERROR(
+          TRITONBACKEND_RequestIsCancelled(requests[r], &is_cancelled),
+          "failed to query request cancellation status");
+    }
+    if (!is_cancelled) {
+      active_requests->push_back(requests[r]);
+      continue;
+    }
+
+    LOG_MESSAGE(
+        TRITONSERVER_LOG_VERBOSE,
+        (std::string("dropping cancelled request for '") + Name() + "'")
+            .c_str());
+    TRITONBACKEND_Response* response;
+    auto err = TRITONBACKEND_ResponseNew(&response, requests[r]);
+    if (err == nullptr) {
+      auto cancelled_err = TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_CANCELLED, "request has been cancelled");
+      LOG_IF_ERROR(
+          TRITONBACKEND_ResponseSend(
+              response, TRITONSERVER_RESPONSE_COMPLETE_FINAL, cancelled_err),
+          "failed to send TensorFlow backend response");
+      TRITONSERVER_ErrorDelete(cancelled_err);
+    } else {
+      LOG_MESSAGE(TRITONSERVER_LOG_ERROR, "Fail to create response");
+      TRITONSERVER_ErrorDelete(err);
+    }
+
+    LOG_IF_ERROR(
+        TRITONBACKEND_RequestRelease(
+            requests[r], TRITONSERVER_REQUEST_RELEASE_ALL),
+        "failed releasing request");
   }
-  RETURN_IF_ERROR(ModelConfig().MemberAsArray("output", &ios));
-  for (size_t i = 0; i < ios.ArraySize(); i++) {
-    triton::common::TritonJson::Value io;
-    RETURN_IF_ERROR(ios.IndexAsObject(i, &io));
-    std::string io_name;
-    RETURN_IF_ERROR(io.MemberAsString("name", &io_name));
-    // Check datatypes
-    std::string io_dtype;
-    RETURN_IF_ERROR(io.MemberAsString("data_type", &io_dtype));
-    RETURN_ERROR_IF_TRUE(
-        ConvertDataType(io_dtype) == TRITONTF_DataType::TRITONTF_TYPE_INVALID,
-        TRITONSERVER_ERROR_INVALID_ARG,
-        std::string("unsupported datatype '") + io_dtype + "' for tensor '" +
-            io_name + "' for model '" + Name() + "'");
+}
+
+void
+ModelInstanceState::GroupRequestsBySignature(
+    TRITONBACKEND_Request** requests, const uint32_t request_count,
+    std::map<std::string, std::vector<TRITONBACKEND_Request*>>* groups)
+{
+  groups->clear();
+  if (model_.signatures_.empty()) {
+    (*groups)[""].assign(requests, requests + request_count);
+    return;
   }
 
-  return nullptr;  // success
+  for (uint32_t r = 0; r < request_count; ++r) {
+    // A nullptr request is reported by ProcessRequests
+    if (requests[r] == nullptr) {
+      (*groups)[""].push_back(requests[r]);
+      continue;
+    }
+
+    std::string signature;
+    uint32_t parameter_count = 0;
+    TRITONSERVER_Error* err =
+        TRITONBACKEND_RequestParameterCount(requests[r], &parameter_count);
+    for (uint32_t p = 0; (err == nullptr) && (p < parameter_count); ++p) {
+      const char* key;
+      TRITONSERVER_ParameterType type;
+      const void* vvalue;
+      err = TRITONBACKEND_RequestParameter(
+          requests[r], p, &key, &type, &vvalue);
+      if ((err == nullptr) && (strcmp(key, "signature") == 0)) {
+        if (type != TRITONSERVER_PARAMETER_STRING) {
+          err = TRITONSERVER_ErrorNew(
+              TRITONSERVER_ERROR_INVALID_ARG,
+              (std::string("request parameter 'signature' must be a string "
+                           "for '") +
+               Name() + "'")
+                  .c_str());
+        } else {
+          signature = reinterpret_cast<const char*>(vvalue);
+        }
+      }
+    }
+
+    // The signature the model was created with can also be selected
+    // by its name.
+    if (signature == StateForModel()->SignatureDef()) {
+      signature.clear();
+    }
+
+    const IONameMap* input_name_map = &model_.input_name_map_;
+    const IONameMap* output_name_map = &model_.output_name_map_;
+    if ((err == nullptr) && !signature.empty()) {
+      auto it = model_.signatures_.find(signature);
+      if (it == model_.signatures_.end()) {
+        err = TRITONSERVER_ErrorNew(
+            TRITONSERVER_ERROR_INVALID_ARG,
+            (std::string("unknown signature '") + signature + "' for '" +
+             Name() + "'")
+                .c_str());
+      } else {
+        input_name_map = &it->second.input_name_map_;
+        output_name_map = &it->second.output_name_map_;
+      }
+    }
+
+    uint32_t input_count = 0;
+    if (err == nullptr) {
+      err = TRITONBACKEND_RequestInputCount(requests[r], &input_count);
+    }
+    for (uint32_t i = 0; (err == nullptr) && (i < input_count); ++i) {
+      const char* input_name;
+      err = TRITONBACKEND_RequestInputName(requests[r], i, &input_name);
+      if ((err == nullptr) &&
+          (input_name_map->find(input_name) == input_name_map->end())) {
+        err = TRITONSERVER_ErrorNew(
+            TRITONSERVER_ERROR_INVALID_ARG,
+            (std::string("input '") + input_name +
+             "' is not an input of signature '" + signature + "' for '" +
+             Name() + "'")
+                .c_str());
+      }
+    }
+    // A request that names no outputs gets every configuration output,
+    // and is only returned the outputs of its signature.
+    uint32_t output_count = 0;
+    if (err == nullptr) {
+      err = TRITONBACKEND_RequestOutputCount(requests[r], &output_count);
+    }
+    std::set<std::string> output_names;
+    for (uint32_t o = 0; (err == nullptr) && (o < output_count); ++o) {
+      const char* output_name;
+      err = TRITONBACKEND_RequestOutputName(requests[r], o, &output_name);
+      if (err == nullptr) {
+        output_names.insert(output_name);
+      }
+    }
+    if ((err == nullptr) &&
+        (output_names != StateForModel()->ConfigOutputNames())) {
+      for (const auto& output_name : output_names) {
+        if (output_name_map->find(output_name) == output_name_map->end()) {
+          err = TRITONSERVER_ErrorNew(
+              TRITONSERVER_ERROR_INVALID_ARG,
+              (std::string("output '") + output_name +
+               "' is not an output of signature '" + signature + "' for '" +
+               Name() + "'")
+                  .c_str());
+          break;
+        }
+      }
+    }
+
+    if (err == nullptr) {
+      (*groups)[signature].push_back(requests[r]);
+      continue;
+    }
+
+    TRITONBACKEND_Response* response;
+    auto response_err = TRITONBACKEND_ResponseNew(&response, requests[r]);
+    if (response_err == nullptr) {
+      LOG_IF_ERROR(
+          TRITONBACKEND_ResponseSend(
+              response, TRITONSERVER_RESPONSE_COMPLETE_FINAL, err),
+          "failed to send TensorFlow backend response");
+    } else {
+      LOG_MESSAGE(TRITONSERVER_LOG_ERROR, "Fail to create response");
+      TRITONSERVER_ErrorDelete(response_err);
+    }
+    TRITONSERVER_ErrorDelete(err);
+
+    LOG_IF_ERROR(
+        TRITONBACKEND_RequestRelease(
+            requests[r], TRITONSERVER_REQUEST_RELEASE_ALL),
+        "failed releasing request");
+  }
 }
 
-//
-// ModelInstanceState
-//
-// State associated with a model instance. An object of this class is
-// created and associated with each TRITONBACKEND_ModelInstance.
-//
-class ModelInstanceState : public BackendModelInstance {
- public:
-  static TRITONSERVER_Error* Create(
-      ModelState* model_state,
-      TRITONBACKEND_ModelInstance* triton_model_instance,
-      ModelInstanceState** state);
-  virtual ~ModelInstanceState() = default;
+void
+ModelInstanceState::SetPaddedInputTensor(
+    TRITONBACKEND_Request** requests, const uint32_t request_count,
+    std::vector<TRITONBACKEND_Response*>* responses,
+    const std::vector<size_t>& request_batch_sizes, const char* name,
+    const TRITONSERVER_DataType datatype,
+    const std::vector<std::vector<int64_t>>& request_shapes,
+    const std::vector<int64_t>& batchn_shape, const double pad_value,
+    TRITONTF_Tensor* tensor)
+{
+  if (TRITONTF_TensorIsGPUTensor(tensor)) {
+    RESPOND_ALL_AND_SET_NULL_IF_ERROR(
+        (*responses), responses->size(),
+        TRITONSERVER_ErrorNew(
+            TRITONSERVER_ERROR_UNSUPPORTED,
+            (std::string("padded input '") + name +
+             "' must be a CPU tensor for '" + Name() + "'")
+                .c_str()));
+    return;
+  }
 
-  // Get the state of the model that corresponds to this instance.
-  ModelState* StateForModel() const { return model_state_; }
+  char* dst = TRITONTF_TensorData(tensor);
+  RESPOND_ALL_AND_SET_NULL_IF_ERROR(
+      (*responses), responses->size(),
+      FillTensorValue(dst, GetElementCount(batchn_shape), datatype, pad_value));
+
+  const size_t element_byte_size = TRITONSERVER_DataTypeByteSize(datatype);
+  const size_t row_byte_size =
+      GetByteSize(datatype, std::vector<int64_t>(
+                                batchn_shape.begin() + 1, batchn_shape.end()));
+  size_t row = 0;
+  for (uint32_t r = 0; r < request_count; ++r) {
+    const auto& shape = request_shapes[r];
+    auto& response = (*responses)[r];
+    if ((response != nullptr) && !shape.empty()) {
+      // Use the request buffer in place if it is a single CPU buffer.
+      TRITONBACKEND_Input* input = nullptr;
+      uint64_t byte_size = 0;
+      uint32_t buffer_count = 0;
+      RESPOND_AND_SET_NULL_IF_ERROR(
+          &response, TRITONBACKEND_RequestInput(requests[r], name, &input));
+      if (response != nullptr) {
+        RESPOND_AND_SET_NULL_IF_ERROR(
+            &response, TRITONBACKEND_InputPropertiesForHostPolicy(
+                           input, HostPolicyName().c_str(), nullptr, nullptr,
+                           nullptr, nullptr, &byte_size, &buffer_count));
+      }
+      const void* src = nullptr;
+      if ((response != nullptr) && (buffer_count == 1)) {
+        uint64_t buffer_byte_size = 0;
+        TRITONSERVER_MemoryType memory_type = TRITONSERVER_MEMORY_CPU;
+        int64_t memory_type_id = 0;
+        RESPOND_AND_SET_NULL_IF_ERROR(
+            &response, TRITONBACKEND_InputBufferForHostPolicy(
+                           input, HostPolicyName().c_str(), 0, &src,
+                           &buffer_byte_size, &memory_type, &memory_type_id));
+        if (memory_type == TRITONSERVER_MEMORY_GPU) {
+          src = nullptr;
+        }
+      }
+      if ((response != nullptr) && (src == nullptr)) {
+        char* buffer = scratch_arena_.Allocate(byte_size);
+        if (buffer == nullptr) {
+          RESPOND_AND_SET_NULL_IF_ERROR(
+              &response, TRITONSERVER_ErrorNew(
+                             TRITONSERVER_ERROR_INTERNAL,
+                             (std::string("failed to allocate ") +
+                              std::to_string(byte_size) +
+                              " bytes for padded input '" + name + "'")
+                                 .c_str()));
+        } else {
+          size_t buffer_byte_size = byte_size;
+          RESPOND_AND_SET_NULL_IF_ERROR(
+              &response,
+              ReadInputTensor(
+                  requests[r], name, buffer, &buffer_byte_size,
+                  HostPolicyName().c_str()));
+          src = buffer;
+        }
+      }
+      if (response != nullptr) {
+        std::vector<int64_t> dst_shape = batchn_shape;
+        dst_shape[0] = shape[0];
+        CopyTensorBlock(
+            reinterpret_cast<const char*>(src), shape,
+            dst + row * row_byte_size, dst_shape, shape, element_byte_size);
+      }
+    }
+    row += request_batch_sizes[r];
+  }
+}
 
-  void ProcessRequests(
-      TRITONBACKEND_Request** requests, const uint32_t request_count);
+bool
+ModelInstanceState::SetBroadcastInputTensor(
+    TRITONBACKEND_Request* request, TRITONBACKEND_Response** response,
+    const char* name, const std::vector<int64_t>& batchn_shape,
+    TRITONTF_Tensor* tensor)
+{
+  // Read the single row into the tensor, or into a CPU buffer if the
+  // tensor is on the GPU, and tile it over the rows.
+  const size_t byte_size = TRITONTF_TensorDataByteSize(tensor);
+  const size_t row_count = (batchn_shape.empty()) ? 1 : batchn_shape[0];
+  const size_t row_byte_size = (row_count == 0) ? 0 : byte_size / row_count;
+  const bool gpu_tensor = TRITONTF_TensorIsGPUTensor(tensor);
+  char* buffer = gpu_tensor ? scratch_arena_.Allocate(byte_size)
+                            : TRITONTF_TensorData(tensor);
+  if (buffer == nullptr) {
+    RESPOND_AND_SET_NULL_IF_ERROR(
+        response, TRITONSERVER_ErrorNew(
+                      TRITONSERVER_ERROR_INTERNAL,
+                      (std::string("failed to allocate ") +
+                       std::to_string(byte_size) +
+                       " bytes for broadcast input '" + name + "'")
+                          .c_str()));
+    return false;
+  }
 
- private:
-  ModelInstanceState(
-      ModelState* model_state,
-      TRITONBACKEND_ModelInstance* triton_model_instance);
+  size_t read_byte_size = row_byte_size;
+  RESPOND_AND_SET_NULL_IF_ERROR(
+      response, ReadInputTensor(
+                    request, name, buffer, &read_byte_size,
+                    HostPolicyName().c_str()));
+  if (*response == nullptr) {
+    return false;
+  }
+  TileRows(buffer, row_byte_size, row_count);
 
-  ModelState* model_state_;
-  // Model for this context.
-  ModelState::Model model_;
-};
+  bool cuda_used = false;
+  if (gpu_tensor) {
+    RESPOND_AND_SET_NULL_IF_ERROR(
+        response, CopyBuffer(
+                      "Broadcast input", TRITONSERVER_MEMORY_CPU, 0,
+                      TRITONSERVER_MEMORY_GPU, DeviceId(), byte_size, buffer,
+                      TRITONTF_TensorData(tensor), CudaStream(), &cuda_used));
+  }
+  return cuda_used;
+}
 
-TRITONSERVER_Error*
-ModelInstanceState::Create(
-    ModelState* model_state, TRITONBACKEND_ModelInstance* triton_model_instance,
-    ModelInstanceState** state)
+bool
+ModelInstanceState::SetCroppedOutput(
+    TRITONBACKEND_Request** requests, const uint32_t request_count,
+    std::vector<TRITONBACKEND_Response*>* responses,
+    const std::vector<std::set<std::string>>& request_required_outputs,
+    const std::vector<size_t>& request_batch_sizes, const std::string& name,
+    TRITONTF_Tensor* output_tensor,
+    const std::vector<std::vector<int64_t>>& request_shapes,
+    const std::vector<int64_t>& input_shape)
 {
-  try {
-    *state = new ModelInstanceState(model_state, triton_model_instance);
+  if (TRITONTF_TensorIsGPUTensor(output_tensor)) {
+    RESPOND_ALL_AND_SET_NULL_IF_ERROR(
+        (*responses), responses->size(),
+        TRITONSERVER_ErrorNew(
+            TRITONSERVER_ERROR_UNSUPPORTED,
+            (std::string("cropped output '") + name +
+             "' must be a CPU tensor for '" + Name() + "'")
+                .c_str()));
+    return false;
   }
-  catch (const BackendModelInstanceException& ex) {
-    RETURN_ERROR_IF_TRUE(
-        ex.err_ == nullptr, TRITONSERVER_ERROR_INTERNAL,
-        std::string("unexpected nullptr in BackendModelInstanceException"));
-    RETURN_IF_ERROR(ex.err_);
+  if (request_shapes.size() != request_count) {
+    RESPOND_ALL_AND_SET_NULL_IF_ERROR(
+        (*responses), responses->size(),
+        TRITONSERVER_ErrorNew(
+            TRITONSERVER_ERROR_INVALID_ARG,
+            (std::string("cropped output '") + name +
+             "' requires the padded input it follows for '" + Name() + "'")
+                .c_str()));
+    return false;
   }
 
-  // If the model configuration doesn't have an explicit model file
-  // specified then use the default name.
-  std::string cc_model_filename = (*state)->ArtifactFilename();
-  if (cc_model_filename.empty()) {
-    if (model_state->IsGraphdef()) {
-      cc_model_filename = "model.graphdef";
-    } else {
-      cc_model_filename = "model.savedmodel";
-    }
-  }
+  const TRITONSERVER_DataType datatype =
+      ConvertDataType(TRITONTF_TensorDataType(output_tensor));
+  const TRITONTF_Shape* tf_shape = TRITONTF_TensorShape(output_tensor);
+  const std::vector<int64_t> batchn_shape(
+      tf_shape->dims_, tf_shape->dims_ + tf_shape->rank_);
+  const size_t element_byte_size = TRITONSERVER_DataTypeByteSize(datatype);
+  const size_t row_byte_size =
+      GetByteSize(datatype, std::vector<int64_t>(
+                                batchn_shape.begin() + 1, batchn_shape.end()));
+  const char* data = TRITONTF_TensorData(output_tensor);
 
-  auto model_path = JoinPath(
-      {model_state->RepositoryPath(), std::to_string(model_state->Version()),
-       cc_model_filename});
+  bool cuda_copy = false;
+  size_t row = 0;
+  for (uint32_t r = 0; r < request_count; ++r) {
+    auto& response = (*responses)[r];
+    const auto& shape = request_shapes[r];
+    if ((response != nullptr) && !shape.empty() &&
+        (request_required_outputs[r].find(name) !=
+         request_required_outputs[r].end())) {
+      std::vector<int64_t> src_shape = batchn_shape;
+      src_shape[0] = request_batch_sizes[r];
+      std::vector<int64_t> output_shape = src_shape;
+      for (size_t d = 1;
+           (d < output_shape.size()) && (d < shape.size()) &&
+           (d < input_shape.size());
+           ++d) {
+        if (output_shape[d] == input_shape[d]) {
+          output_shape[d] = shape[d];
+        }
+      }
 
-  {
-    bool exists;
-    RETURN_IF_ERROR(FileExists(model_path, &exists));
-    RETURN_ERROR_IF_FALSE(
-        exists, TRITONSERVER_ERROR_UNAVAILABLE,
-        std::string("unable to find '") + model_path +
-            "' for model instance '" + (*state)->Name() + "'");
+      TRITONBACKEND_Output* response_output;
+      RESPOND_AND_SET_NULL_IF_ERROR(
+          &response, TRITONBACKEND_ResponseOutput(
+                         response, &response_output, name.c_str(), datatype,
+                         output_shape.data(), output_shape.size()));
+      const size_t byte_size = GetByteSize(datatype, output_shape);
+      void* buffer = nullptr;
+      TRITONSERVER_MemoryType memory_type = TRITONSERVER_MEMORY_CPU;
+      int64_t memory_type_id = 0;
+      if (response != nullptr) {
+        RESPOND_AND_SET_NULL_IF_ERROR(
+            &response,
+            TRITONBACKEND_OutputBuffer(
+                response_output, &buffer, byte_size, &memory_type,
+                &memory_type_id));
+      }
+      if (response != nullptr) {
+        const char* src = data + row * row_byte_size;
+        if (memory_type != TRITONSERVER_MEMORY_GPU) {
+          CopyTensorBlock(
+              src, src_shape, reinterpret_cast<char*>(buffer), output_shape,
+              output_shape, element_byte_size);
+        } else {
+          // Crop into a CPU buffer and copy that to the GPU buffer.
+          char* cropped = scratch_arena_.Allocate(byte_size);
+          if (cropped == nullptr) {
+            RESPOND_AND_SET_NULL_IF_ERROR(
+                &response, TRITONSERVER_ErrorNew(
+                               TRITONSERVER_ERROR_INTERNAL,
+                               (std::string("failed to allocate ") +
+                                std::to_string(byte_size) +
+                                " bytes for cropped output '" + name + "'")
+                                   .c_str()));
+          } else {
+            CopyTensorBlock(
+                src, src_shape, cropped, output_shape, output_shape,
+                element_byte_size);
+            bool cuda_used = false;
+            RESPOND_AND_SET_NULL_IF_ERROR(
+                &response, CopyBuffer(
+                               "Cropped output", TRITONSERVER_MEMORY_CPU, 0,
+                               memory_type, memory_type_id, byte_size,
+                               cropped, buffer, CudaStream(), &cuda_used));
+            cuda_copy |= cuda_used;
+          }
+        }
+      }
+    }
+    row += request_batch_sizes[r];
   }
 
-  int gpu_device;
-  switch ((*state)->Kind()) {
-    case TRITONSERVER_INSTANCEGROUPKIND_CPU:
-      gpu_device = ModelState::NO_GPU_DEVICE;
-      break;
-    case TRITONSERVER_INSTANCEGROUPKIND_MODEL:
-      gpu_device = ModelState::MODEL_DEVICE;
-      break;
-    default:
-      gpu_device = (*state)->DeviceId();
-      break;
+  return cuda_copy;
+}
+
+void
+ModelInstanceState::SplitRequestsByLength(
+    TRITONBACKEND_Request** requests, const uint32_t request_count,
+    std::vector<std::vector<TRITONBACKEND_Request*>>* sub_batches)
+{
+  const auto& buckets = StateForModel()->RaggedLengthBuckets();
+  sub_batches->clear();
+  if (buckets.empty()) {
+    sub_batches->emplace_back(requests, requests + request_count);
+    return;
   }
 
-  RETURN_IF_ERROR(
-      model_state->GetModel(gpu_device, model_path, &(*state)->model_));
+  // The last bucket holds the requests longer than every bound, and
+  // the requests whose length can't be read, which ProcessRequests
+  // responds to with the error.
+  std::vector<std::vector<TRITONBACKEND_Request*>> bucket_requests(
+      buckets.size() + 1);
+  for (uint32_t r = 0; r < request_count; ++r) {
+    int64_t length = std::numeric_limits<int64_t>::max();
+    uint32_t input_count = 0;
+    if ((requests[r] != nullptr) &&
+        (TRITONBACKEND_RequestInputCount(requests[r], &input_count) ==
+         nullptr)) {
+      length = 0;
+      for (uint32_t i = 0; i < input_count; ++i) {
+        TRITONBACKEND_Input* input;
+        const char* name;
+        const int64_t* shape;
+        uint32_t dims_count;
+        TRITONSERVER_Error* err =
+            TRITONBACKEND_RequestInputByIndex(requests[r], i, &input);
+        if (err == nullptr) {
+          err = TRITONBACKEND_InputProperties(
+              input, &name, nullptr, &shape, &dims_count, nullptr, nullptr);
+        }
+        if (err != nullptr) {
+          TRITONSERVER_ErrorDelete(err);
+          length = std::numeric_limits<int64_t>::max();
+          break;
+        }
+        if (StateForModel()->IsInputRagged(name)) {
+          length = std::max(length, GetElementCount(shape, dims_count));
+        }
+      }
+    }
 
-  return nullptr;  // success
-}
+    const size_t bucket =
+        std::lower_bound(buckets.begin(), buckets.end(), length) -
+        buckets.begin();
+    bucket_requests[bucket].push_back(requests[r]);
+  }
 
-ModelInstanceState::ModelInstanceState(
-    ModelState* model_state, TRITONBACKEND_ModelInstance* triton_model_instance)
-    : BackendModelInstance(model_state, triton_model_instance),
-      model_state_(model_state)
-{
+  for (auto& bucket : bucket_requests) {
+    if (!bucket.empty()) {
+      sub_batches->emplace_back(std::move(bucket));
+    }
+  }
+  if (sub_batches->size() > 1) {
+    LOG_MESSAGE(
+        TRITONSERVER_LOG_VERBOSE,
+        (std::string("split ") + std::to_string(request_count) +
+         " requests of '" + Name() + "' into " +
+         std::to_string(sub_batches->size()) + " sub-batches by length")
+            .c_str());
+  }
 }
 
 void
 ModelInstanceState::ProcessRequests(
-    TRITONBACKEND_Request** requests, const uint32_t request_count)
+    TRITONBACKEND_Request** requests, const uint32_t request_count,
+    const std::string& signature)
 {
+  // The name maps of the signature the requests run with
+  const IONameMap& input_name_map =
+      signature.empty() ? model_.input_name_map_
+                        : model_.signatures_.at(signature).input_name_map_;
+  const IONameMap& output_name_map =
+      signature.empty() ? model_.output_name_map_
+                        : model_.signatures_.at(signature).output_name_map_;
+
   LOG_MESSAGE(
       TRITONSERVER_LOG_VERBOSE,
       (std::string("TRITONBACKEND_ModelExecute: Running ") + Name() + " with " +
@@ -1928,12 +5127,24 @@ ModelInstanceState::ProcessRequests(
   uint64_t exec_start_ns = 0;
   SET_TIMESTAMP(exec_start_ns);
 
+  // Buffers of the previous execution are no longer in use.
+  scratch_arena_.Reset();
+
   const int max_batch_size = StateForModel()->MaxBatchSize();
+  const bool has_sequence_states = !StateForModel()->SequenceStates().empty();
+  if (has_sequence_states) {
+    EvictIdleSequenceStates();
+  }
 
   // For each request collect the total batch size for this inference
   // execution. The batch-size, number of inputs, and size of each
   // input has already been checked so don't need to do that here.
+  // Also find the tightest timeout of the requests, which bounds the
+  // run of the whole batch.
   size_t total_batch_size = 0;
+  uint64_t run_timeout_us = 0;
+  std::vector<size_t> request_batch_sizes;
+  request_batch_sizes.reserve(request_count);
   for (size_t i = 0; i < request_count; i++) {
     // If we get a nullptr request then something is badly wrong. Fail
     // and release all requests.
@@ -1949,6 +5160,16 @@ ModelInstanceState::ProcessRequests(
       return;
     }
 
+    uint64_t timeout_us = 0;
+    LOG_IF_ERROR(
+        TRITONBACKEND_InferenceRequestTimeoutMicroseconds(
+            requests[i], &timeout_us),
+        "failed to get request timeout");
+    if ((timeout_us != 0) &&
+        ((run_timeout_us == 0) || (timeout_us < run_timeout_us))) {
+      run_timeout_us = timeout_us;
+    }
+
     if (max_batch_size > 0) {
       // Retrieve the batch size from one of the inputs,
       // if the model support batching, the first dimension size is batch size
@@ -1960,6 +5181,7 @@ ModelInstanceState::ProcessRequests(
         err = TRITONBACKEND_InputProperties(
             input, nullptr, nullptr, &shape, nullptr, nullptr, nullptr);
         total_batch_size += shape[0];
+        request_batch_sizes.push_back(shape[0]);
       }
       if (err != nullptr) {
         RequestsRespondWithError(requests, request_count, err);
@@ -1967,6 +5189,7 @@ ModelInstanceState::ProcessRequests(
       }
     } else {
       total_batch_size += 1;
+      request_batch_sizes.push_back(1);
     }
   }
 
@@ -2040,6 +5263,12 @@ ModelInstanceState::ProcessRequests(
   // must use TF-specific string tensor APIs.
   bool cuda_copy = false;
 
+  // The request shapes and the batch shape of the padded inputs, to
+  // crop the outputs that follow them.
+  std::map<std::string, std::vector<std::vector<int64_t>>>
+      padded_request_shapes;
+  std::map<std::string, std::vector<int64_t>> padded_batch_shapes;
+
   BackendInputCollector collector(
       requests, request_count, &responses,
       StateForModel()->TritonMemoryManager(),
@@ -2050,6 +5279,7 @@ ModelInstanceState::ProcessRequests(
     // request as the representative for the input tensors.
     uint32_t input_count;
     TRITONBACKEND_RequestInputCount(requests[0], &input_count);
+    std::string shape_signature;
     for (uint32_t input_idx = 0; input_idx < input_count; input_idx++) {
       TRITONBACKEND_Input* input;
       TRITONBACKEND_RequestInputByIndex(requests[0], input_idx, &input);
@@ -2061,9 +5291,65 @@ ModelInstanceState::ProcessRequests(
           input, &name, &datatype, &shape, &dims_count, nullptr, nullptr);
 
       std::vector<int64_t> batchn_shape;
+      // A padded input tensor has the largest request shape of the
+      // batch, rounded up to the multiple of the input
+      const auto padded_itr = StateForModel()->PaddedInputs().find(name);
+      const bool padded =
+          (padded_itr != StateForModel()->PaddedInputs().end());
+      if (padded) {
+        auto& request_shapes = padded_request_shapes[name];
+        request_shapes.assign(request_count, {});
+        for (size_t idx = 0; idx < request_count; idx++) {
+          TRITONBACKEND_Input* input;
+          RESPOND_AND_SET_NULL_IF_ERROR(
+              &responses[idx],
+              TRITONBACKEND_RequestInput(requests[idx], name, &input));
+          const int64_t* shape;
+          uint32_t dims_count;
+          if (responses[idx] != nullptr) {
+            RESPOND_AND_SET_NULL_IF_ERROR(
+                &responses[idx], TRITONBACKEND_InputProperties(
+                                     input, nullptr, nullptr, &shape,
+                                     &dims_count, nullptr, nullptr));
+          }
+          if (responses[idx] == nullptr) {
+            continue;
+          }
+          if (!batchn_shape.empty() && (batchn_shape.size() != dims_count)) {
+            RESPOND_AND_SET_NULL_IF_ERROR(
+                &responses[idx],
+                TRITONSERVER_ErrorNew(
+                    TRITONSERVER_ERROR_INVALID_ARG,
+                    (std::string("padded input '") + name + "' of rank " +
+                     std::to_string(dims_count) +
+                     " can't be batched with rank " +
+                     std::to_string(batchn_shape.size()) + " for '" +
+                     Name() + "'")
+                        .c_str()));
+            continue;
+          }
+          request_shapes[idx].assign(shape, shape + dims_count);
+          if (batchn_shape.empty()) {
+            batchn_shape = request_shapes[idx];
+          }
+          for (size_t d = 1; d < dims_count; ++d) {
+            batchn_shape[d] = std::max(batchn_shape[d], shape[d]);
+          }
+        }
+        if (batchn_shape.empty()) {
+          batchn_shape.assign(shape, shape + dims_count);
+        }
+        const int64_t multiple = padded_itr->second.multiple_;
+        for (size_t d = 1; d < batchn_shape.size(); ++d) {
+          batchn_shape[d] = (batchn_shape[d] + multiple - 1) / multiple *
+                            multiple;
+        }
+        batchn_shape[0] = total_batch_size;
+        padded_batch_shapes[name] = batchn_shape;
+      }
       // For a ragged input tensor, the tensor shape should be
       // the flatten shape of the whole batch
-      if (StateForModel()->IsInputRagged(name)) {
+      else if (StateForModel()->IsInputRagged(name)) {
         batchn_shape = std::vector<int64_t>{0};
         for (size_t idx = 0; idx < request_count; idx++) {
           TRITONBACKEND_Input* input;
@@ -2088,10 +5374,52 @@ ModelInstanceState::ProcessRequests(
         }
       }
 
+      // A broadcast input has its single row repeated to the first
+      // dimension of its reference input. A model without batching
+      // runs a single request.
+      const auto broadcast_itr = StateForModel()->BroadcastInputs().find(name);
+      const bool broadcast =
+          (broadcast_itr != StateForModel()->BroadcastInputs().end());
+      if (broadcast) {
+        TRITONBACKEND_Input* reference;
+        const int64_t* reference_shape = nullptr;
+        uint32_t reference_dims_count = 0;
+        RESPOND_AND_SET_NULL_IF_ERROR(
+            &responses[0],
+            TRITONBACKEND_RequestInput(
+                requests[0], broadcast_itr->second.c_str(), &reference));
+        if (responses[0] != nullptr) {
+          RESPOND_AND_SET_NULL_IF_ERROR(
+              &responses[0], TRITONBACKEND_InputProperties(
+                                 reference, nullptr, nullptr, &reference_shape,
+                                 &reference_dims_count, nullptr, nullptr));
+        }
+        if ((responses[0] != nullptr) &&
+            ((dims_count == 0) || (shape[0] != 1) ||
+             (reference_dims_count == 0))) {
+          RESPOND_AND_SET_NULL_IF_ERROR(
+              &responses[0],
+              TRITONSERVER_ErrorNew(
+                  TRITONSERVER_ERROR_INVALID_ARG,
+                  (std::string("broadcast input '") + name + "' with shape " +
+                   backend::ShapeToString(shape, dims_count) +
+                   " must have a first dimension of size 1 to broadcast to "
+                   "input '" +
+                   broadcast_itr->second + "' for '" + Name() + "'")
+                      .c_str()));
+        }
+        if (responses[0] != nullptr) {
+          batchn_shape[0] = reference_shape[0];
+        }
+      }
+      if (track_shapes_) {
+        shape_signature += std::string(name) + ShapeToString(batchn_shape);
+      }
+
       // The name of the input in the model can be different...
       const char* input_tensor_name = name;
-      const auto& tn_itr = model_.input_name_map_.find(input_tensor_name);
-      if (tn_itr != model_.input_name_map_.end()) {
+      const auto& tn_itr = input_name_map.find(input_tensor_name);
+      if (tn_itr != input_name_map.end()) {
         input_tensor_name = tn_itr->second.c_str();
       }
 
@@ -2102,12 +5430,12 @@ ModelInstanceState::ProcessRequests(
       TRITONTF_Tensor* tensor = TRITONTF_TensorNew(
           input_tensor_name, ConvertDataType(datatype), batchn_shape.size(),
           (batchn_shape.size() == 0) ? nullptr : &batchn_shape[0],
-          model_.input_device_id_);
+          model_.input_device_id_, numa_node_);
       if (tensor == nullptr) {
         auto err = TRITONSERVER_ErrorNew(
             TRITONSERVER_ERROR_INTERNAL,
             (std::string("failed to create input tensor '") + name +
-             "' with shape " + backend::ShapeToString(batchn_shape) +
+             "' with shape " + ShapeToString(batchn_shape) +
              " and data type " + TRITONSERVER_DataTypeString(datatype) +
              " for '" + Name() + "'")
                 .c_str());
@@ -2134,8 +5462,19 @@ ModelInstanceState::ProcessRequests(
           TRITONTF_TensorListNew(tensor, *input_tensors);
       *input_tensors = tlink;
 
+      if (padded) {
+        SetPaddedInputTensor(
+            requests, request_count, &responses, request_batch_sizes, name,
+            datatype, padded_request_shapes[name], batchn_shape,
+            padded_itr->second.pad_value_, tensor);
+      } else if (broadcast) {
+        if (responses[0] != nullptr) {
+          cuda_copy |= SetBroadcastInputTensor(
+              requests[0], &responses[0], name, batchn_shape, tensor);
+        }
+      }
       // Custom handling for string/bytes tensor...
-      if (datatype == TRITONSERVER_TYPE_BYTES) {
+      else if (datatype == TRITONSERVER_TYPE_BYTES) {
         size_t tensor_offset = 0;
 
         for (size_t idx = 0; idx < request_count; idx++) {
@@ -2157,7 +5496,7 @@ ModelInstanceState::ProcessRequests(
           cuda_copy |= SetStringInputTensor(
               tensor, input, name, buffer_count, batch_element_cnt,
               tensor_offset, &responses[idx], CudaStream(),
-              HostPolicyName().c_str());
+              HostPolicyName().c_str(), &scratch_arena_);
           tensor_offset += batch_element_cnt;
         }
       }
@@ -2179,6 +5518,16 @@ ModelInstanceState::ProcessRequests(
               .c_str());
     }
 
+    // oneDNN creates the primitives of a CPU run for its input shapes,
+    // so a new combination of shapes makes it create new primitives.
+    if (track_shapes_ && !shape_cache_.Lookup(shape_signature)) {
+      LOG_MESSAGE(
+          TRITONSERVER_LOG_VERBOSE,
+          (std::string("new input shapes for '") + Name() +
+           "': " + shape_signature)
+              .c_str());
+    }
+
     // Process batch input if any
     for (const auto& batch_input : StateForModel()->BatchInputs()) {
       std::vector<int64_t> shape;
@@ -2187,8 +5536,8 @@ ModelInstanceState::ProcessRequests(
       for (const auto& input_name : batch_input.TargetNames()) {
         // The name of the input in the model can be different...
         const char* input_tensor_name = input_name.c_str();
-        const auto& tn_itr = model_.input_name_map_.find(input_name);
-        if (tn_itr != model_.input_name_map_.end()) {
+        const auto& tn_itr = input_name_map.find(input_name);
+        if (tn_itr != input_name_map.end()) {
           input_tensor_name = tn_itr->second.c_str();
         }
 
@@ -2199,7 +5548,7 @@ ModelInstanceState::ProcessRequests(
         TRITONTF_Tensor* tensor = TRITONTF_TensorNew(
             input_tensor_name, ConvertDataType(batch_input.DataType()),
             shape.size(), (shape.size() == 0) ? nullptr : &shape[0],
-            model_.input_device_id_);
+            model_.input_device_id_, numa_node_);
         if (tensor == nullptr) {
           auto err = TRITONSERVER_ErrorNew(
               TRITONSERVER_ERROR_INTERNAL,
@@ -2260,12 +5609,39 @@ ModelInstanceState::ProcessRequests(
       }
     }
 
+    // Feed the sequence state kept by the backend, if any
+    if (has_sequence_states) {
+      auto err = SetSequenceStateInputs(
+          requests, request_count, request_batch_sizes, total_batch_size,
+          input_tensors.get(), &cuda_copy);
+      if (err != nullptr) {
+        // Send remaining responses and returned
+        for (uint32_t r = 0; r < request_count; ++r) {
+          if (responses[r] != nullptr) {
+            LOG_IF_ERROR(
+                TRITONBACKEND_ResponseSend(
+                    responses[r], TRITONSERVER_RESPONSE_COMPLETE_FINAL, err),
+                "failed to send TensorFlow backend response");
+          }
+
+          LOG_IF_ERROR(
+              TRITONBACKEND_RequestRelease(
+                  requests[r], TRITONSERVER_REQUEST_RELEASE_ALL),
+              "failed releasing request");
+        }
+        TRITONSERVER_ErrorDelete(err);
+        return;
+      }
+    }
+
     // Finalize...
     cuda_copy |= collector.Finalize();
   }
 
   // Collect the names of requested outputs. Do not include outputs
-  // for requests that have already responded with an error.
+  // for requests that have already responded with an error, or the
+  // outputs that a request of a model with several signatures gets
+  // implicitly but the signature of the run doesn't have.
   std::set<std::string> required_outputs;
   std::vector<std::set<std::string>> request_required_outputs(request_count);
   for (size_t idx = 0; idx < request_count; idx++) {
@@ -2281,7 +5657,10 @@ ModelInstanceState::ProcessRequests(
           RESPOND_AND_SET_NULL_IF_ERROR(
               &response, TRITONBACKEND_RequestOutputName(
                              request, output_idx, &output_name));
-          if (response != nullptr) {
+          if ((response != nullptr) &&
+              (model_.signatures_.empty() ||
+               (output_name_map.find(output_name) !=
+                output_name_map.end()))) {
             required_outputs.insert(output_name);
             request_required_outputs[idx].insert(output_name);
           }
@@ -2290,6 +5669,13 @@ ModelInstanceState::ProcessRequests(
     }
   }
 
+  // The outputs holding the next sequence state are always required
+  // but are only returned to the client when requested.
+  std::set<std::string> client_outputs = required_outputs;
+  for (const auto& state : StateForModel()->SequenceStates()) {
+    required_outputs.insert(state.output_name_);
+  }
+
   // Create the vector of required output names using the names
   // expected by the model.
   std::vector<std::string> model_output_names;
@@ -2298,8 +5684,8 @@ ModelInstanceState::ProcessRequests(
     size_t oidx = 0;
     for (const auto& name : required_outputs) {
       model_output_names.push_back(name);
-      const auto& tn_itr = model_.output_name_map_.find(name);
-      if (tn_itr == model_.output_name_map_.end()) {
+      const auto& tn_itr = output_name_map.find(name);
+      if (tn_itr == output_name_map.end()) {
         output_names_cstr[oidx] = name.c_str();
       } else {
         output_names_cstr[oidx] = tn_itr->second.c_str();
@@ -2325,12 +5711,99 @@ ModelInstanceState::ProcessRequests(
   {
     TRITONTF_TensorList* rtl = nullptr;
 
+    // Round the timeout up so that a sub-millisecond timeout doesn't
+    // turn into an unbounded run.
+    TRITONTF_RunOptions run_options;
+    run_options.timeout_in_ms_ = (run_timeout_us + 999) / 1000;
+    run_options.micro_batch_count_ = 1;
+    if ((StateForModel()->MicroBatchCount() > 1) &&
+        (total_batch_size >=
+         (size_t)std::max(StateForModel()->MicroBatchMinSize(), 2))) {
+      run_options.micro_batch_count_ = StateForModel()->MicroBatchCount();
+    }
+    run_options.thread_pools_ = thread_pools_.get();
+    run_options.signature_def_ = signature.c_str();
+    run_options.sequential_micro_batches_ = false;
+    run_options.cpu_bytes_ = nullptr;
+
+    // Admit the run against the CPU memory budget, shrinking it into
+    // sequential micro-batches if only part of the batch fits. Runs
+    // through a callable can't be measured or split.
+    int64_t cpu_bytes = 0;
+    int64_t reserved_cpu_bytes = 0;
+    if (StateForModel()->HasCpuMemoryBudget() &&
+        (model_.input_device_id_ == ModelState::MODEL_DEVICE)) {
+      int budget_micro_batch_count = 1;
+      bool trace = false;
+      auto err = StateForModel()->ReserveCpuMemory(
+          total_batch_size, &budget_micro_batch_count, &reserved_cpu_bytes,
+          &trace);
+      if (err != nullptr) {
+        // Send remaining responses and returned
+        for (uint32_t r = 0; r < request_count; ++r) {
+          if (responses[r] != nullptr) {
+            LOG_IF_ERROR(
+                TRITONBACKEND_ResponseSend(
+                    responses[r], TRITONSERVER_RESPONSE_COMPLETE_FINAL, err),
+                "failed to send TensorFlow backend response");
+          }
+
+          LOG_IF_ERROR(
+              TRITONBACKEND_RequestRelease(
+                  requests[r], TRITONSERVER_REQUEST_RELEASE_ALL),
+              "failed releasing request");
+        }
+        TRITONSERVER_ErrorDelete(err);
+        return;
+      }
+      if (budget_micro_batch_count > 1) {
+        run_options.micro_batch_count_ =
+            std::max(run_options.micro_batch_count_, budget_micro_batch_count);
+        run_options.sequential_micro_batches_ = true;
+      }
+      if (trace) {
+        run_options.cpu_bytes_ = &cpu_bytes;
+      }
+    }
+
+    std::map<std::string, uint64_t> grappler_pass_usecs;
+    if (!has_run_) {
+      TRITONTF_GrapplerPassTimes(&grappler_pass_usecs);
+    }
+
     TRITONTF_Error* tf_err = TRITONTF_ModelRun(
         model_.tritontf_model_.get(), *(input_tensors.release()),
-        required_outputs.size(), output_names_cstr, &rtl);
+        required_outputs.size(), output_names_cstr, &run_options, &rtl);
+    if (StateForModel()->HasCpuMemoryBudget()) {
+      StateForModel()->ReleaseCpuMemory(reserved_cpu_bytes);
+      if ((tf_err == nullptr) && (run_options.cpu_bytes_ != nullptr)) {
+        size_t concurrent_items = total_batch_size;
+        if (run_options.sequential_micro_batches_) {
+          const size_t count = std::min(
+              (size_t)run_options.micro_batch_count_, total_batch_size);
+          concurrent_items = (total_batch_size + count - 1) / count;
+        }
+        StateForModel()->RecordCpuMemory(concurrent_items, cpu_bytes);
+      }
+    }
+    if (!has_run_) {
+      has_run_ = true;
+      LogGrapplerPassTimes(
+          "first run of instance '" + Name() + "'", grappler_pass_usecs);
+    }
     if (tf_err != nullptr) {
+      // A run that exceeded the request timeout isn't a model failure,
+      // the client may retry it.
       auto err =
-          TRITONSERVER_ErrorNew(TRITONSERVER_ERROR_INTERNAL, tf_err->msg_);
+          tf_err->timed_out_
+              ? TRITONSERVER_ErrorNew(
+                    TRITONSERVER_ERROR_UNAVAILABLE,
+                    (std::string("run of '") + Name() + "' timed out after " +
+                     std::to_string(run_options.timeout_in_ms_) +
+                     " ms: " + tf_err->msg_)
+                        .c_str())
+              : TRITONSERVER_ErrorNew(
+                    TRITONSERVER_ERROR_INTERNAL, tf_err->msg_);
       TRITONTF_ErrorDelete(tf_err);
       // Send remaining responses and returned
       for (uint32_t r = 0; r < request_count; ++r) {
@@ -2360,19 +5833,30 @@ ModelInstanceState::ProcessRequests(
   // into each. For tensors with string data type we must handle
   // ourselves since we must use TF-specific string tensor APIs.
   cuda_copy = false;
-  // The serialized string buffer must be valid until output copies are done
-  std::vector<std::unique_ptr<std::string>> string_buffer;
   BackendOutputResponder responder(
       requests, request_count, &responses,
       StateForModel()->TritonMemoryManager(), max_batch_size > 0,
       StateForModel()->EnablePinnedOutput(), CudaStream());
   {
+    std::unordered_map<std::string, TRITONTF_Tensor*> state_output_tensors;
     TRITONTF_TensorList* output_tensor_itr = output_tensors.get();
     for (const auto& name : model_output_names) {
       TRITONTF_Tensor* output_tensor = output_tensor_itr->tensor_;
+      state_output_tensors.emplace(name, output_tensor);
+      if (client_outputs.find(name) == client_outputs.end()) {
+        output_tensor_itr = output_tensor_itr->next_;
+        continue;
+      }
 
       const BatchOutput* batch_output = StateForModel()->FindBatchOutput(name);
-      if (batch_output == nullptr) {
+      const auto crop_itr = StateForModel()->CroppedOutputs().find(name);
+      if (crop_itr != StateForModel()->CroppedOutputs().end()) {
+        cuda_copy |= SetCroppedOutput(
+            requests, request_count, &responses, request_required_outputs,
+            request_batch_sizes, name, output_tensor,
+            padded_request_shapes[crop_itr->second],
+            padded_batch_shapes[crop_itr->second]);
+      } else if (batch_output == nullptr) {
         TRITONTF_DataType tf_datatype = TRITONTF_TensorDataType(output_tensor);
         TRITONTF_Shape* tf_shape = TRITONTF_TensorShape(output_tensor);
 
@@ -2418,10 +5902,9 @@ ModelInstanceState::ProcessRequests(
                   TRITONBACKEND_ResponseOutput(
                       response, &response_output, name.c_str(), datatype,
                       batchn_shape.data(), batchn_shape.size()));
-              string_buffer.emplace_back(new std::string());
               cuda_copy |= SetStringOutputBuffer(
                   output_tensor, &response, response_output, tensor_element_cnt,
-                  tensor_offset, CudaStream(), string_buffer.back().get());
+                  tensor_offset, CudaStream(), &scratch_arena_);
             }
 
             tensor_offset += tensor_element_cnt;
@@ -2455,6 +5938,14 @@ ModelInstanceState::ProcessRequests(
       output_tensor_itr = output_tensor_itr->next_;
     }
 
+    // Keep the next sequence state before the output tensors are
+    // released.
+    if (has_sequence_states) {
+      cuda_copy |= SaveSequenceStateOutputs(
+          requests, request_count, responses, request_batch_sizes,
+          state_output_tensors);
+    }
+
     // Finalize and wait for any pending buffer copies.
     cuda_copy |= responder.Finalize();
   }
@@ -2597,7 +6088,118 @@ TRITONBACKEND_Initialize(TRITONBACKEND_Backend* backend)
       RETURN_IF_ERROR(ParseIntValue(value_str, &lvalue));
       lconfig->default_max_batch_size_ = lvalue;
     }
+    if (cmdline.Find("huge-pages", &value)) {
+      RETURN_IF_ERROR(value.AsString(&value_str));
+      if (value_str == "transparent") {
+        lconfig->huge_page_mode_ = HugePageMode::TRANSPARENT;
+      } else if (value_str == "explicit") {
+        lconfig->huge_page_mode_ = HugePageMode::EXPLICIT;
+      } else if (value_str != "none") {
+        return TRITONSERVER_ErrorNew(
+            TRITONSERVER_ERROR_INVALID_ARG,
+            (std::string("unexpected value '") + value_str +
+             "' for 'huge-pages', expected 'none', 'transparent' or "
+             "'explicit'")
+                .c_str());
+      }
+    }
+    if (cmdline.Find("allocator-metrics-interval-ms", &value)) {
+      RETURN_IF_ERROR(value.AsString(&value_str));
+      int lvalue;
+      RETURN_IF_ERROR(ParseIntValue(value_str, &lvalue));
+      if (lvalue < 0) {
+        return TRITONSERVER_ErrorNew(
+            TRITONSERVER_ERROR_INVALID_ARG,
+            "'allocator-metrics-interval-ms' must be non-negative");
+      }
+      lconfig->allocator_metrics_interval_ms_ = lvalue;
+    }
+    if (cmdline.Find("onednn", &value)) {
+      RETURN_IF_ERROR(value.AsString(&value_str));
+      bool lvalue;
+      RETURN_IF_ERROR(ParseBoolValue(value_str, &lvalue));
+      lconfig->onednn_ = lvalue ? 1 : 0;
+    }
+    if (cmdline.Find("onednn-primitive-cache-capacity", &value)) {
+      RETURN_IF_ERROR(value.AsString(&value_str));
+      int lvalue;
+      RETURN_IF_ERROR(ParseIntValue(value_str, &lvalue));
+      if (lvalue < 0) {
+        return TRITONSERVER_ErrorNew(
+            TRITONSERVER_ERROR_INVALID_ARG,
+            "'onednn-primitive-cache-capacity' must be non-negative");
+      }
+      lconfig->onednn_primitive_cache_capacity_ = lvalue;
+    }
+    if (cmdline.Find("onednn-native-format", &value)) {
+      RETURN_IF_ERROR(value.AsString(&value_str));
+      bool lvalue;
+      RETURN_IF_ERROR(ParseBoolValue(value_str, &lvalue));
+      lconfig->onednn_native_format_ = lvalue ? 1 : 0;
+    }
+    const std::vector<std::pair<const char*, std::string*>> amp_lists{
+        {"amp-allow-list-add", &lconfig->amp_allow_list_add_},
+        {"amp-allow-list-remove", &lconfig->amp_allow_list_remove_},
+        {"amp-deny-list-add", &lconfig->amp_deny_list_add_},
+        {"amp-deny-list-remove", &lconfig->amp_deny_list_remove_}};
+    for (const auto& amp_list : amp_lists) {
+      if (cmdline.Find(amp_list.first, &value)) {
+        RETURN_IF_ERROR(value.AsString(amp_list.second));
+      }
+    }
+  }
+
+  // TensorFlow and oneDNN read their options once per process, so the
+  // oneDNN options are backend-wide and set before any model is loaded.
+  RETURN_IF_TRITONTF_ERROR(TRITONTF_SetOneDNNOptions(
+      lconfig->onednn_, lconfig->onednn_primitive_cache_capacity_,
+      lconfig->onednn_native_format_));
+
+  // Grappler reads the auto mixed precision op lists from the process
+  // environment, which is only set here before any model is loaded.
+  RETURN_IF_TRITONTF_ERROR(TRITONTF_SetAutoMixedPrecisionLists(
+      lconfig->amp_allow_list_add_.c_str(),
+      lconfig->amp_allow_list_remove_.c_str(),
+      lconfig->amp_deny_list_add_.c_str(),
+      lconfig->amp_deny_list_remove_.c_str()));
+
+  // The TF CPU allocator is process-wide so huge pages must be enabled
+  // before any model creates it.
+  if (lconfig->huge_page_mode_ != HugePageMode::NONE) {
+    RETURN_IF_TRITONTF_ERROR(TRITONTF_EnableHugePages());
+    SetStagingBufferHugePageMode(lconfig->huge_page_mode_);
+  }
+
+  // Load phase metrics are best effort as metrics may be disabled.
+  {
+    TRITONSERVER_Error* err = TRITONSERVER_MetricFamilyNew(
+        &lconfig->load_phase_metric_family_, TRITONSERVER_METRIC_KIND_GAUGE,
+        "nv_tensorflow_model_load_phase_duration_us",
+        "Duration of a phase of the latest load of the model on the device");
+    if (err != nullptr) {
+      LOG_MESSAGE(
+          TRITONSERVER_LOG_VERBOSE,
+          (std::string("load phase metrics are not available: ") +
+           TRITONSERVER_ErrorMessage(err))
+              .c_str());
+      TRITONSERVER_ErrorDelete(err);
+      lconfig->load_phase_metric_family_ = nullptr;
+    }
+  }
+
+  // The CPU allocator only keeps statistics when asked to, and only
+  // for the memory allocated afterwards.
+  if (lconfig->allocator_metrics_interval_ms_ > 0) {
+    TRITONTF_EnableCPUAllocatorStats();
+    for (const auto& allocator_metric : kAllocatorMetrics) {
+      TRITONSERVER_MetricFamily* family;
+      RETURN_IF_ERROR(TRITONSERVER_MetricFamilyNew(
+          &family, TRITONSERVER_METRIC_KIND_GAUGE, allocator_metric.name_,
+          allocator_metric.description_));
+      lconfig->allocator_metric_families_.push_back(family);
+    }
   }
+
   RETURN_IF_ERROR(TRITONBACKEND_BackendSetState(
       backend, reinterpret_cast<void*>(lconfig.get())));
 
@@ -2614,6 +6216,34 @@ TRITONBACKEND_Finalize(TRITONBACKEND_Backend* backend)
   void* vstate;
   RETURN_IF_ERROR(TRITONBACKEND_BackendState(backend, &vstate));
   auto config = reinterpret_cast<BackendConfiguration*>(vstate);
+  if (config->huge_page_mode_ != HugePageMode::NONE) {
+    LOG_MESSAGE(
+        TRITONSERVER_LOG_INFO,
+        (std::string("peak huge page memory: ") +
+         std::to_string(TRITONTF_HugePagePeakByteSize()) +
+         " bytes of TensorFlow CPU memory advised, " +
+         std::to_string(StagingBufferHugePagePeakByteSize()) +
+         " bytes of staging buffers mapped or advised")
+            .c_str());
+  }
+  for (TRITONSERVER_MetricFamily* family : config->allocator_metric_families_) {
+    LOG_IF_ERROR(
+        TRITONSERVER_MetricFamilyDelete(family),
+        "failed to delete metric family");
+  }
+  if (config->load_phase_metric_family_ != nullptr) {
+    LOG_IF_ERROR(
+        TRITONSERVER_MetricFamilyDelete(config->load_phase_metric_family_),
+        "failed to delete metric family");
+  }
+  if (config->parked_model_thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(config->restorable_models_mu_);
+      config->stop_parked_model_reaper_ = true;
+    }
+    config->parked_model_cv_.notify_all();
+    config->parked_model_thread_.join();
+  }
   delete config;
   return nullptr;  // success
 }
@@ -2763,7 +6393,43 @@ TRITONBACKEND_ModelInstanceExecute(
   // this function. If something does go wrong in processing a
   // particular request then we send an error response just for the
   // specific request.
-  instance_state->ProcessRequests(requests, request_count);
+  // Requests that have been cancelled while waiting to be executed
+  // are responded to right away so they don't take a slot in the
+  // batch.
+  std::vector<TRITONBACKEND_Request*> active_requests;
+  instance_state->RemoveCancelledRequests(
+      requests, request_count, &active_requests);
+  // The session may not be created yet, or may have been released
+  // while the instance was idle. If it can't be created the requests
+  // fail.
+  std::lock_guard<std::mutex> model_lock(instance_state->ModelMutex());
+  if (!active_requests.empty()) {
+    TRITONSERVER_Error* err = instance_state->AcquireModel();
+    if (err != nullptr) {
+      RequestsRespondWithError(
+          active_requests.data(), active_requests.size(), err);
+      active_requests.clear();
+    }
+  }
+  // Requests that select different signatures of the model are run
+  // separately.
+  std::map<std::string, std::vector<TRITONBACKEND_Request*>> groups;
+  if (!active_requests.empty()) {
+    instance_state->GroupRequestsBySignature(
+        active_requests.data(), active_requests.size(), &groups);
+  }
+  // Requests of different lengths are run in separate sub-batches if
+  // the model has length buckets.
+  for (auto& group : groups) {
+    std::vector<std::vector<TRITONBACKEND_Request*>> sub_batches;
+    instance_state->SplitRequestsByLength(
+        group.second.data(), group.second.size(), &sub_batches);
+    for (auto& sub_batch : sub_batches) {
+      instance_state->ProcessRequests(
+          sub_batch.data(), sub_batch.size(), group.first);
+    }
+  }
+  instance_state->MarkActive(SteadyClockNs());
 
   return nullptr;  // success
 }
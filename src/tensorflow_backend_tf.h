@@ -29,6 +29,8 @@
 #include <stdint.h>
 
 #include <map>
+#include <string>
+#include <utility>
 #include <vector>
 
 // To avoid namespace and protobuf collision between Triton and
@@ -63,6 +65,8 @@ extern "C" {
 typedef struct {
   // The error message as a null-terminated string.
   char* msg_;
+  // Whether the error is a run that exceeded its timeout.
+  bool timed_out_;
 } TRITONTF_Error;
 
 // Delete an error.
@@ -84,7 +88,8 @@ typedef enum {
   TRITONTF_TYPE_FP16,
   TRITONTF_TYPE_FP32,
   TRITONTF_TYPE_FP64,
-  TRITONTF_TYPE_STRING
+  TRITONTF_TYPE_STRING,
+  TRITONTF_TYPE_BF16
 } TRITONTF_DataType;
 
 typedef enum {
@@ -103,6 +108,26 @@ typedef struct {
   int64_t max_cached_engines_;
 } TRITONTF_TFTRTConfig;
 
+typedef enum {
+  TRITONTF_TOGGLE_DEFAULT,
+  TRITONTF_TOGGLE_ON,
+  TRITONTF_TOGGLE_OFF
+} TRITONTF_Toggle;
+
+// Config for the grappler rewriters of the model session. A rewriter
+// set to TRITONTF_TOGGLE_DEFAULT keeps the TensorFlow default.
+typedef struct {
+  TRITONTF_Toggle remapping_;
+  TRITONTF_Toggle arithmetic_optimization_;
+  TRITONTF_Toggle dependency_optimization_;
+  TRITONTF_Toggle loop_optimization_;
+  TRITONTF_Toggle memory_optimization_;
+  TRITONTF_Toggle model_pruning_;
+  // Number of meta optimizer iterations, 1 or 2, or 0 to keep the
+  // TensorFlow default.
+  int meta_optimizer_iterations_;
+} TRITONTF_GrapplerConfig;
+
 // A shape
 typedef struct {
   // Number of dimensions in the shape
@@ -163,11 +188,13 @@ TRITONTF_EXPORT void TRITONTF_TensorListDelete(TRITONTF_TensorList* list);
 // GPU input for model that supports GPU I/O (see TRITONTF_ModelMakeCallable),
 // 'tf_gpu_id' must be the same as the model's device id. Otherwise, negative
 // value should be provided. Note that a tensor may be created on CPU if
-// the data type is not supported for GPU tensor.
+// the data type is not supported for GPU tensor. A CPU tensor is
+// allocated on NUMA node 'numa_node', a negative value indicates no
+// NUMA preference.
 // Return nullptr if failed to create the tensor.
 TRITONTF_EXPORT TRITONTF_Tensor* TRITONTF_TensorNew(
     const char* name, TRITONTF_DataType dtype, size_t shape_rank,
-    int64_t* shape_dims, int tf_gpu_id);
+    int64_t* shape_dims, int tf_gpu_id, int numa_node);
 
 // Return a tensor's datatype.
 TRITONTF_EXPORT TRITONTF_DataType
@@ -211,6 +238,106 @@ TRITONTF_EXPORT const char* TRITONTF_TensorString(
 TRITONTF_EXPORT void TRITONTF_TensorSetString(
     TRITONTF_Tensor* tensor, size_t idx, const char* str, size_t length);
 
+// Set 'count' strings starting at index 'idx' within a tensor, the
+// i-th string is the 'lengths[i]' characters at 'strs[i]'. Defined
+// only for string type.. bad things might happen if called for
+// non-string type tensor. The strings are copied by the tensor so the
+// caller retains ownership of 'strs'.
+TRITONTF_EXPORT void TRITONTF_TensorSetStrings(
+    TRITONTF_Tensor* tensor, size_t idx, size_t count, const char** strs,
+    const size_t* lengths);
+
+//
+// Memory
+//
+
+// Back the CPU memory allocated by TensorFlow, including the CPU
+// tensors created by TRITONTF_TensorNew, with transparent huge
+// pages. This switches the TensorFlow CPU allocator to a BFC allocator
+// unless TF_CPU_ALLOCATOR_USE_BFC is already set. The TensorFlow CPU
+// allocator is process-wide so this must be called before any model
+// is created.
+TRITONTF_EXPORT TRITONTF_Error* TRITONTF_EnableHugePages();
+
+// Return the number of bytes of the TensorFlow CPU memory that is
+// advised to use transparent huge pages, which the kernel backs with
+// huge pages when it can.
+TRITONTF_EXPORT size_t TRITONTF_HugePageByteSize();
+
+// Return the largest number of bytes of the TensorFlow CPU memory that
+// has been advised to use transparent huge pages at any time.
+TRITONTF_EXPORT size_t TRITONTF_HugePagePeakByteSize();
+
+// Make the TensorFlow CPU allocator keep statistics, which it doesn't
+// by default as it costs a lock per allocation. The statistics only
+// account for the memory allocated afterwards so this must be called
+// before any model is created.
+TRITONTF_EXPORT void TRITONTF_EnableCPUAllocatorStats();
+
+// Memory statistics of an allocator
+typedef struct {
+  int64_t num_allocs_;
+  int64_t bytes_in_use_;
+  int64_t peak_bytes_in_use_;
+  int64_t largest_alloc_size_;
+} TRITONTF_AllocatorStats;
+
+//
+// oneDNN
+//
+
+// Set the process-wide oneDNN options of TensorFlow. 'enable' turns
+// the oneDNN CPU kernels on or off, 'primitive_cache_capacity' is the
+// number of primitives oneDNN keeps in its primitive cache and
+// 'native_format' selects the plain TensorFlow tensor layout over the
+// blocked oneDNN layout between oneDNN ops. A negative value keeps
+// the TensorFlow default. The options are read by TensorFlow and
+// oneDNN once, so this must be called before any model is created.
+TRITONTF_EXPORT TRITONTF_Error* TRITONTF_SetOneDNNOptions(
+    const int enable, const int primitive_cache_capacity,
+    const int native_format);
+
+// Return true if TensorFlow runs its oneDNN CPU kernels.
+TRITONTF_EXPORT bool TRITONTF_OneDNNEnabled();
+
+// Set the process-wide updates of the op lists of the auto mixed
+// precision graph rewriters. Each list is a comma-separated list of op
+// names that are added to or removed from the corresponding op list,
+// nullptr or an empty string keeps the default op list. Grappler reads
+// the lists from the process environment, so they apply to the CPU
+// and GPU rewriters of every model and this must be called before any
+// model is created.
+TRITONTF_EXPORT TRITONTF_Error* TRITONTF_SetAutoMixedPrecisionLists(
+    const char* allow_list_add, const char* allow_list_remove,
+    const char* deny_list_add, const char* deny_list_remove);
+
+//
+// Thread pools
+//
+
+// Opaque handle to a pair of intra-op and inter-op thread pools that
+// can be used by model runs in place of the thread pools of the model
+// session.
+struct TRITONTF_ThreadPools;
+
+// Create thread pools named 'name'. 'num_intra_threads' and
+// 'num_inter_threads' are the number of threads of the intra-op and
+// the inter-op thread pool. If the number is <= 0, the corresponding
+// thread pool is not created and the runs using these thread pools
+// will use that thread pool of the model session instead. The
+// threads are pinned to the 'cpu_count' CPUs listed in 'cpu_ids' and
+// to NUMA node 'numa_node'. 'cpu_count' 0 and negative 'numa_node'
+// indicate no affinity.
+TRITONTF_EXPORT TRITONTF_Error* TRITONTF_ThreadPoolsNew(
+    TRITONTF_ThreadPools** thread_pools, const char* name,
+    const int num_intra_threads, const int num_inter_threads,
+    const int* cpu_ids, const size_t cpu_count, const int numa_node);
+
+// Delete thread pools. Any runs using the thread pools must have
+// completed.
+TRITONTF_EXPORT void TRITONTF_ThreadPoolsDelete(
+    TRITONTF_ThreadPools* thread_pools);
+
 //
 // Model
 //
@@ -218,7 +345,11 @@ TRITONTF_EXPORT void TRITONTF_TensorSetString(
 // Opaque handle to a model
 struct TRITONTF_Model;
 
-// Create a GraphDef model.
+// Create a GraphDef model. If 'keep_node_count' is not 0, the graph
+// is pruned before the session is created to the 'keep_node_count'
+// nodes or tensors named in 'keep_nodes' and the nodes they depend
+// on. 'has_init_ops' tells if TRITONTF_ModelInitialize will run init
+// ops on the model, which needs the structure of the graph.
 TRITONTF_EXPORT TRITONTF_Error* TRITONTF_ModelCreateFromGraphDef(
     TRITONTF_Model** trtistf_model, const char* model_name,
     const char* model_path, const int device_id, const int num_intra_threads,
@@ -228,9 +359,14 @@ TRITONTF_EXPORT TRITONTF_Error* TRITONTF_ModelCreateFromGraphDef(
     const float per_process_gpu_memory_fraction,
     const bool allow_soft_placement,
     const std::map<int, std::vector<float>>& memory_limit_mb,
-    const TRITONTF_TFTRTConfig* tftrt_config, const bool auto_mixed_precision);
-
-// Create a SavedModel model.
+    const TRITONTF_TFTRTConfig* tftrt_config, const bool auto_mixed_precision,
+    const bool cpu_auto_mixed_precision,
+    const TRITONTF_GrapplerConfig* grappler_config, const char** keep_nodes,
+    const size_t keep_node_count, const bool has_init_ops);
+
+// Create a SavedModel model. If 'freeze_variables' is true, the
+// variables are converted to constants once they are restored and the
+// model runs with a session created from the frozen graph.
 TRITONTF_EXPORT TRITONTF_Error* TRITONTF_ModelCreateFromSavedModel(
     TRITONTF_Model** trtistf_model, const char* model_name,
     const char* model_path, const int device_id, const int num_intra_threads,
@@ -241,21 +377,40 @@ TRITONTF_EXPORT TRITONTF_Error* TRITONTF_ModelCreateFromSavedModel(
     const float per_process_gpu_memory_fraction,
     const bool allow_soft_placement,
     const std::map<int, std::vector<float>>& memory_limit_mb,
-    const TRITONTF_TFTRTConfig* tftrt_config, const bool auto_mixed_precision);
+    const TRITONTF_TFTRTConfig* tftrt_config, const bool auto_mixed_precision,
+    const bool cpu_auto_mixed_precision,
+    const TRITONTF_GrapplerConfig* grappler_config,
+    const bool freeze_variables);
 
 // Delete a model.
 TRITONTF_EXPORT void TRITONTF_ModelDelete(TRITONTF_Model* model);
 
+// Get the cumulative time, in microseconds, that each grappler
+// optimization pass has taken for all the models in the process,
+// keyed by the name of the pass.
+TRITONTF_EXPORT void TRITONTF_GrapplerPassTimes(
+    std::map<std::string, uint64_t>* pass_usecs);
+
 // Create a Callable for the model so that the inputs will be assumed to be from
 // GPU while the outputs will be produced on GPU. The Callable will assume the
 // inputs are on the same TF device (vGPU) as the model session.
 // Note that depending on the data type, GPU tensor may not be supported,
 // in such case, the callable will expect those unsupported I/Os to be on CPU.
+// The callable is used by the runs of signature 'signature_def', nullptr
+// or empty string for the signature the model was created with.
 TRITONTF_Error* TRITONTF_ModelMakeCallable(
     TRITONTF_Model* model, const char** input_names,
     const TRITONTF_DataType* input_types, const size_t num_inputs,
     const char** output_names, const TRITONTF_DataType* output_types,
-    const size_t num_outputs);
+    const size_t num_outputs, const char* signature_def);
+
+// Get in 'stats' the statistics of the allocator of each device that
+// the model session uses, keyed by device name. An allocator is shared
+// by all the sessions that use the device. Devices whose allocator
+// doesn't keep statistics are left out.
+TRITONTF_EXPORT TRITONTF_Error* TRITONTF_ModelAllocatorStats(
+    TRITONTF_Model* model,
+    std::map<std::string, TRITONTF_AllocatorStats>* stats);
 
 // Get information about a model inputs. The returned list is owned by
 // the model and should not be modified or freed by the caller.
@@ -265,21 +420,97 @@ TRITONTF_EXPORT TRITONTF_IOList* TRITONTF_ModelInputs(TRITONTF_Model* model);
 // by the model and should not be modified or freed by the caller.
 TRITONTF_EXPORT TRITONTF_IOList* TRITONTF_ModelOutputs(TRITONTF_Model* model);
 
+// Get information about the inputs and outputs of signature
+// 'signature_def' of a SavedModel model, which may be other than the
+// signature the model was created with. The returned lists are owned
+// by the model and should not be modified or freed by the caller.
+TRITONTF_EXPORT TRITONTF_Error* TRITONTF_ModelSignatureIO(
+    TRITONTF_Model* model, const char* signature_def, TRITONTF_IOList** inputs,
+    TRITONTF_IOList** outputs);
+
+// Options that apply to a single model run.
+typedef struct {
+  // The maximum time, in milliseconds, that the run may take before
+  // it is cancelled. Zero indicates that the run is not bounded. The
+  // timeout is not applied if the model has a callable (see
+  // TRITONTF_ModelMakeCallable) as callables can't be given
+  // per-run options.
+  int64_t timeout_in_ms_;
+
+  // The number of micro-batches to split the batch into. The
+  // micro-batches run concurrently on the model session and the
+  // outputs are concatenated along the batch dimension. All inputs
+  // and outputs must have the batch as the first dimension. A value
+  // <= 1 runs the batch as a whole. Like the timeout, this is not
+  // applied if the model has a callable.
+  int micro_batch_count_;
+
+  // Run the micro-batches one after another instead of concurrently,
+  // which bounds the memory of the run to that of one micro-batch.
+  bool sequential_micro_batches_;
+
+  // If not nullptr, returns the bytes that the run allocated from the
+  // CPU allocators, which bounds its peak CPU memory from above. For
+  // sequential micro-batches this is the largest of the micro-batches.
+  // Collecting it traces the run, so it should only be requested
+  // occasionally. Not applied if the model has a callable.
+  int64_t* cpu_bytes_;
+
+  // The thread pools to execute the run with. nullptr indicates that
+  // the thread pools of the model session are used.
+  TRITONTF_ThreadPools* thread_pools_;
+
+  // The signature whose inputs and outputs the run uses, nullptr or
+  // empty string for the signature the model was created with. The
+  // callable of the signature is used if it has one.
+  const char* signature_def_;
+} TRITONTF_RunOptions;
+
 // Run a model using the provides input tensors to produce the named
 // outputs. Ownership of the 'input_tensors' is passed to the model
 // and the caller must not access (or free) it after this
-// call. 'output_tensors' returns the outputs in the same order as
+// call. 'run_options' may be nullptr to run with default options.
+// 'output_tensors' returns the outputs in the same order as
 // 'output_names'. The caller must free 'output_tensors' by calling
 // TRITONTF_TensorListDelete.
 TRITONTF_EXPORT TRITONTF_Error* TRITONTF_ModelRun(
     TRITONTF_Model* model, TRITONTF_TensorList* input_tensors,
     size_t num_outputs, const char** output_names,
+    const TRITONTF_RunOptions* run_options,
     TRITONTF_TensorList** output_tensors);
 
-// Initialize all the operations that do require initialization.
+// Initialize all the operations that do require initialization. The
+// operations that neither depend on each other nor share a variable or
+// table run together in a single session run, otherwise they run in
+// the given order. 'op_usecs' returns, for each operation in the given
+// order, the time in microseconds that it took to complete from the
+// start of the session run that included it.
 TRITONTF_EXPORT TRITONTF_Error* TRITONTF_ModelInitialize(
     TRITONTF_Model* model, size_t num_init_operations,
-    const char** init_operation_names);
+    const char** init_operation_names,
+    std::vector<std::pair<std::string, uint64_t>>* op_usecs);
+
+// Compute in 'hash' a hash of the graph, signatures and saver of the
+// MetaGraphDef tagged 'graph_tag' in the SavedModel at 'model_path',
+// without loading the model. SavedModels with the same hash differ
+// only in the values of their variables.
+TRITONTF_EXPORT TRITONTF_Error* TRITONTF_SavedModelGraphHash(
+    const char* model_path, const char* graph_tag, uint64_t* hash);
+
+// Restore the variables of a SavedModel model from the checkpoint of
+// the SavedModel at 'model_path', which must have the same graph hash
+// as the SavedModel the model was created from, and run the init op
+// of the SavedModel again with the assets at 'model_path'. The model
+// must not be running.
+TRITONTF_EXPORT TRITONTF_Error* TRITONTF_ModelRestoreVariables(
+    TRITONTF_Model* model, const char* model_path);
+
+// Get the time, in microseconds, of each phase of the creation of the
+// model, in the order the phases ran. A phase named 'x/y' is part of
+// phase 'x'.
+TRITONTF_EXPORT void TRITONTF_ModelLoadPhases(
+    TRITONTF_Model* model,
+    std::vector<std::pair<std::string, uint64_t>>* phase_usecs);
 
 // Load a library and register its ops/kernels.
 TRITONTF_EXPORT TRITONTF_Error* TRITONTF_LoadAndRegisterLibrary(
@@ -26,10 +26,47 @@
 
 #include "tensorflow_utils.h"
 
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <type_traits>
+
 #include "triton/backend/backend_common.h"
 
 namespace triton { namespace backend { namespace tensorflow {
 
+namespace {
+
+constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+
+// Every staging buffer is preceded by a header recording how it was
+// allocated, the header size keeps the buffer cache-line aligned.
+struct StagingBufferHeader {
+  size_t allocated_byte_size_;
+  size_t huge_page_byte_size_;
+  bool mmapped_;
+};
+constexpr size_t kStagingBufferHeaderSize = 64;
+static_assert(
+    sizeof(StagingBufferHeader) <= kStagingBufferHeaderSize,
+    "staging buffer header doesn't fit");
+
+std::atomic<int> staging_buffer_huge_page_mode{
+    static_cast<int>(HugePageMode::NONE)};
+std::atomic<size_t> staging_buffer_huge_page_bytes{0};
+std::atomic<size_t> staging_buffer_huge_page_peak_bytes{0};
+
+}  // namespace
+
 bool
 ModelSupportsBatch(std::vector<const TRITONTF_IOList*> model_ios)
 {
@@ -211,6 +248,8 @@ ConvertDataType(TRITONTF_DataType dtype)
       return TRITONSERVER_TYPE_FP64;
     case TRITONTF_DataType::TRITONTF_TYPE_STRING:
       return TRITONSERVER_TYPE_BYTES;
+    case TRITONTF_DataType::TRITONTF_TYPE_BF16:
+      return TRITONSERVER_TYPE_BF16;
     default:
       break;
   }
@@ -249,6 +288,8 @@ ConvertDataType(const std::string& dtype)
     return TRITONTF_DataType::TRITONTF_TYPE_FP64;
   } else if (dtype == "TYPE_STRING") {
     return TRITONTF_DataType::TRITONTF_TYPE_STRING;
+  } else if (dtype == "TYPE_BF16") {
+    return TRITONTF_DataType::TRITONTF_TYPE_BF16;
   }
   return TRITONTF_DataType::TRITONTF_TYPE_INVALID;
 }
@@ -284,6 +325,8 @@ ConvertToModelConfigString(TRITONTF_DataType dtype)
     return "TYPE_FP64";
   } else if (dtype == TRITONTF_DataType::TRITONTF_TYPE_STRING) {
     return "TYPE_STRING";
+  } else if (dtype == TRITONTF_DataType::TRITONTF_TYPE_BF16) {
+    return "TYPE_BF16";
   }
   return "TYPE_INVALID";
 }
@@ -320,6 +363,8 @@ ConvertDataType(TRITONSERVER_DataType dtype)
       return TRITONTF_DataType::TRITONTF_TYPE_FP64;
     case TRITONSERVER_TYPE_BYTES:
       return TRITONTF_DataType::TRITONTF_TYPE_STRING;
+    case TRITONSERVER_TYPE_BF16:
+      return TRITONTF_DataType::TRITONTF_TYPE_BF16;
     default:
       break;
   }
@@ -327,6 +372,595 @@ ConvertDataType(TRITONSERVER_DataType dtype)
   return TRITONTF_DataType::TRITONTF_TYPE_INVALID;
 }
 
+std::vector<std::string>
+SplitString(const std::string& str, const char delim)
+{
+  std::vector<std::string> res;
+  size_t start = 0;
+  while (true) {
+    const size_t end = str.find(delim, start);
+    if (end == std::string::npos) {
+      res.emplace_back(str.substr(start));
+      break;
+    }
+    res.emplace_back(str.substr(start, end - start));
+    start = end + 1;
+  }
+
+  return res;
+}
+
+TRITONSERVER_Error*
+ParseCpuList(const std::string& str, std::vector<int>* cpus)
+{
+  // A CPU set holds CPU_SETSIZE CPUs, pinning to a CPU past that
+  // would silently pin to none.
+  const long host_cpu_count = std::min(
+      sysconf(_SC_NPROCESSORS_CONF), static_cast<long>(CPU_SETSIZE));
+  cpus->clear();
+  for (const auto& range : SplitString(str, ',')) {
+    if (range.empty()) {
+      continue;
+    }
+    const auto bounds = SplitString(range, '-');
+    int first = 0;
+    int last = 0;
+    if ((bounds.size() != 1) && (bounds.size() != 2)) {
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (std::string("invalid CPU range '") + range + "' in '" + str + "'")
+              .c_str());
+    }
+    RETURN_IF_ERROR(ParseIntValue(bounds[0], &first));
+    last = first;
+    if (bounds.size() == 2) {
+      RETURN_IF_ERROR(ParseIntValue(bounds[1], &last));
+    }
+    if ((first < 0) || (last < first)) {
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (std::string("invalid CPU range '") + range + "' in '" + str + "'")
+              .c_str());
+    }
+    if (last >= host_cpu_count) {
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (std::string("CPU range '") + range + "' in '" + str +
+           "' exceeds the " + std::to_string(host_cpu_count) +
+           " CPUs of the host")
+              .c_str());
+    }
+    for (int cpu = first; cpu <= last; ++cpu) {
+      cpus->push_back(cpu);
+    }
+  }
+
+  return nullptr;  // success
+}
+
+TRITONSERVER_Error*
+NumaNodeCpus(const int numa_node, std::vector<int>* cpus)
+{
+  const std::string path = "/sys/devices/system/node/node" +
+                           std::to_string(numa_node) + "/cpulist";
+  std::ifstream in(path);
+  std::string cpu_list;
+  if (!in || !std::getline(in, cpu_list)) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INVALID_ARG,
+        (std::string("unable to read the CPUs of NUMA node ") +
+         std::to_string(numa_node) + " from '" + path + "'")
+            .c_str());
+  }
+  RETURN_IF_ERROR(ParseCpuList(cpu_list, cpus));
+  if (cpus->empty()) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INVALID_ARG,
+        (std::string("NUMA node ") + std::to_string(numa_node) +
+         " has no CPUs")
+            .c_str());
+  }
+  return nullptr;  // success
+}
+
+namespace {
+
+// 64-bit FNV-1a
+constexpr uint64_t kFnvOffsetBasis = 14695981039346656037ULL;
+constexpr uint64_t kFnvPrime = 1099511628211ULL;
+
+void
+FnvUpdate(const char* data, const size_t byte_size, uint64_t* hash)
+{
+  for (size_t i = 0; i < byte_size; ++i) {
+    *hash ^= static_cast<unsigned char>(data[i]);
+    *hash *= kFnvPrime;
+  }
+}
+
+}  // namespace
+
+TRITONSERVER_Error*
+HashModelFiles(
+    const std::string& path, std::string* canonical_path, uint64_t* hash)
+{
+  namespace fs = std::filesystem;
+
+  std::error_code ec;
+  const fs::path root = fs::canonical(path, ec);
+  if (ec) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INTERNAL,
+        (std::string("unable to resolve model path '") + path +
+         "': " + ec.message())
+            .c_str());
+  }
+  *canonical_path = root.string();
+
+  // Hash the files in a fixed order so that the hash doesn't depend
+  // on the order the directory is listed in.
+  std::vector<fs::path> files;
+  if (fs::is_directory(root, ec)) {
+    for (fs::recursive_directory_iterator it(
+             root, fs::directory_options::follow_directory_symlink, ec),
+         end;
+         !ec && (it != end); it.increment(ec)) {
+      if (it->is_regular_file(ec)) {
+        files.push_back(it->path());
+      }
+    }
+  } else {
+    files.push_back(root);
+  }
+  if (ec) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INTERNAL,
+        (std::string("unable to list model path '") + path +
+         "': " + ec.message())
+            .c_str());
+  }
+  std::sort(files.begin(), files.end());
+
+  *hash = kFnvOffsetBasis;
+  std::vector<char> buffer(1 << 20);
+  for (const auto& file : files) {
+    const std::string relative = file.lexically_relative(root).string();
+    FnvUpdate(relative.c_str(), relative.size() + 1, hash);
+
+    std::ifstream in(file, std::ios::binary);
+    if (!in) {
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INTERNAL,
+          (std::string("unable to read model file '") + file.string() + "'")
+              .c_str());
+    }
+    while (in) {
+      in.read(buffer.data(), buffer.size());
+      FnvUpdate(buffer.data(), in.gcount(), hash);
+    }
+  }
+
+  return nullptr;  // success
+}
+
+TRITONSERVER_Error*
+ParseStringBuffer(
+    const char* buffer, const size_t buffer_byte_size,
+    const size_t expected_element_cnt, const char* input_name,
+    const char** strs, size_t* lengths, size_t* parsed_element_cnt)
+{
+  // Each length depends on where the previous element ends so the
+  // walk is inherently sequential. Keep it to a single pass with an
+  // unaligned load, two bounds checks and two stores per element.
+  const char* const end = buffer + buffer_byte_size;
+  const char* ptr = buffer;
+  size_t element_idx = 0;
+  while (static_cast<size_t>(end - ptr) >= sizeof(uint32_t)) {
+    if (element_idx >= expected_element_cnt) {
+      *parsed_element_cnt = element_idx;
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          std::string(
+              "unexpected number of string elements " +
+              std::to_string(element_idx + 1) + " for inference input '" +
+              input_name + "', expecting " +
+              std::to_string(expected_element_cnt))
+              .c_str());
+    }
+
+    uint32_t len;
+    memcpy(&len, ptr, sizeof(uint32_t));
+    ptr += sizeof(uint32_t);
+
+    const size_t remaining_bytes = end - ptr;
+    if (remaining_bytes < len) {
+      *parsed_element_cnt = element_idx;
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          std::string(
+              "incomplete string data for inference input '" +
+              std::string(input_name) + "', expecting string of length " +
+              std::to_string(len) + " but only " +
+              std::to_string(remaining_bytes) + " bytes available")
+              .c_str());
+    }
+
+    strs[element_idx] = ptr;
+    lengths[element_idx] = len;
+    ptr += len;
+    ++element_idx;
+  }
+
+  *parsed_element_cnt = element_idx;
+  if (element_idx != expected_element_cnt) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INTERNAL,
+        std::string(
+            "expected " + std::to_string(expected_element_cnt) +
+            " strings for inference input '" + input_name + "', got " +
+            std::to_string(element_idx))
+            .c_str());
+  }
+
+  return nullptr;  // success
+}
+
+namespace {
+
+// Copy the block of 'block_dims' from dimension 'dim' on. The strides
+// are in bytes.
+void
+CopyBlockDims(
+    const char* src, const std::vector<size_t>& src_strides, char* dst,
+    const std::vector<size_t>& dst_strides,
+    const std::vector<int64_t>& block_dims, const size_t dim)
+{
+  if (dim + 1 == block_dims.size()) {
+    memcpy(dst, src, block_dims[dim] * src_strides[dim]);
+    return;
+  }
+  for (int64_t i = 0; i < block_dims[dim]; ++i) {
+    CopyBlockDims(
+        src + i * src_strides[dim], src_strides, dst + i * dst_strides[dim],
+        dst_strides, block_dims, dim + 1);
+  }
+}
+
+template <typename T>
+void
+FillValue(char* dst, const size_t element_cnt, const T value)
+{
+  std::fill_n(reinterpret_cast<T*>(dst), element_cnt, value);
+}
+
+// Return true if 'value' converts to 'T' without changing it. The
+// range is checked before converting, as converting an out of range
+// value is undefined.
+template <typename T>
+bool
+IsRepresentable(const double value)
+{
+  if (std::is_integral<T>::value) {
+    // 'max() + 1' is a power of two, so it is exact as a double even
+    // for 64-bit types, where 'max()' itself is not.
+    return (value >= static_cast<double>(std::numeric_limits<T>::min())) &&
+           (value < static_cast<double>(std::numeric_limits<T>::max()) + 1) &&
+           (std::trunc(value) == value);
+  }
+  if (!std::isfinite(value)) {
+    return true;
+  }
+  return (std::abs(value) <= std::numeric_limits<T>::max()) &&
+         (static_cast<double>(static_cast<T>(value)) == value);
+}
+
+TRITONSERVER_Error*
+UnrepresentableValueError(
+    const TRITONSERVER_DataType datatype, const double value)
+{
+  return TRITONSERVER_ErrorNew(
+      TRITONSERVER_ERROR_INVALID_ARG,
+      (std::string("value ") + std::to_string(value) +
+       " is not representable in data type " +
+       TRITONSERVER_DataTypeString(datatype))
+          .c_str());
+}
+
+template <typename T>
+TRITONSERVER_Error*
+FillRepresentableValue(
+    char* dst, const size_t element_cnt, const TRITONSERVER_DataType datatype,
+    const double value)
+{
+  if (!IsRepresentable<T>(value)) {
+    return UnrepresentableValueError(datatype, value);
+  }
+  FillValue<T>(dst, element_cnt, static_cast<T>(value));
+  return nullptr;  // success
+}
+
+}  // namespace
+
+void
+CopyTensorBlock(
+    const char* src, const std::vector<int64_t>& src_dims, char* dst,
+    const std::vector<int64_t>& dst_dims,
+    const std::vector<int64_t>& block_dims, const size_t element_byte_size)
+{
+  if (block_dims.empty()) {
+    memcpy(dst, src, element_byte_size);
+    return;
+  }
+  for (const int64_t dim : block_dims) {
+    if (dim <= 0) {
+      return;
+    }
+  }
+
+  std::vector<size_t> src_strides(src_dims.size()),
+      dst_strides(dst_dims.size());
+  size_t src_stride = element_byte_size;
+  size_t dst_stride = element_byte_size;
+  for (size_t i = block_dims.size(); i-- > 0;) {
+    src_strides[i] = src_stride;
+    dst_strides[i] = dst_stride;
+    src_stride *= src_dims[i];
+    dst_stride *= dst_dims[i];
+  }
+  CopyBlockDims(src, src_strides, dst, dst_strides, block_dims, 0);
+}
+
+void
+TileRows(char* buffer, const size_t row_byte_size, const size_t row_count)
+{
+  const size_t total_byte_size = row_byte_size * row_count;
+  size_t filled_byte_size = std::min(row_byte_size, total_byte_size);
+  while (filled_byte_size < total_byte_size) {
+    const size_t copy_byte_size =
+        std::min(filled_byte_size, total_byte_size - filled_byte_size);
+    memcpy(buffer + filled_byte_size, buffer, copy_byte_size);
+    filled_byte_size += copy_byte_size;
+  }
+}
+
+TRITONSERVER_Error*
+FillTensorValue(
+    char* dst, const size_t element_cnt, const TRITONSERVER_DataType datatype,
+    const double value)
+{
+  switch (datatype) {
+    case TRITONSERVER_TYPE_BOOL:
+      return FillRepresentableValue<bool>(dst, element_cnt, datatype, value);
+    case TRITONSERVER_TYPE_UINT8:
+      return FillRepresentableValue<uint8_t>(dst, element_cnt, datatype, value);
+    case TRITONSERVER_TYPE_UINT16:
+      return FillRepresentableValue<uint16_t>(dst, element_cnt, datatype, value);
+    case TRITONSERVER_TYPE_UINT32:
+      return FillRepresentableValue<uint32_t>(dst, element_cnt, datatype, value);
+    case TRITONSERVER_TYPE_UINT64:
+      return FillRepresentableValue<uint64_t>(dst, element_cnt, datatype, value);
+    case TRITONSERVER_TYPE_INT8:
+      return FillRepresentableValue<int8_t>(dst, element_cnt, datatype, value);
+    case TRITONSERVER_TYPE_INT16:
+      return FillRepresentableValue<int16_t>(dst, element_cnt, datatype, value);
+    case TRITONSERVER_TYPE_INT32:
+      return FillRepresentableValue<int32_t>(dst, element_cnt, datatype, value);
+    case TRITONSERVER_TYPE_INT64:
+      return FillRepresentableValue<int64_t>(dst, element_cnt, datatype, value);
+    case TRITONSERVER_TYPE_FP32:
+      return FillRepresentableValue<float>(dst, element_cnt, datatype, value);
+    case TRITONSERVER_TYPE_FP64:
+      return FillRepresentableValue<double>(dst, element_cnt, datatype, value);
+    case TRITONSERVER_TYPE_BF16: {
+      // bfloat16 is the upper half of the float32 representation, so
+      // the value must not use the lower half.
+      if (!IsRepresentable<float>(value)) {
+        return UnrepresentableValueError(datatype, value);
+      }
+      const float fvalue = value;
+      uint32_t bits;
+      memcpy(&bits, &fvalue, sizeof(bits));
+      if ((bits & 0xFFFF) != 0) {
+        return UnrepresentableValueError(datatype, value);
+      }
+      FillValue<uint16_t>(dst, element_cnt, bits >> 16);
+      break;
+    }
+    case TRITONSERVER_TYPE_FP16:
+      // Only zero, whose float16 representation is all zero bits, is
+      // supported without a float16 conversion.
+      if (value == 0) {
+        FillValue<uint16_t>(dst, element_cnt, 0);
+        break;
+      }
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          "only zero can fill tensors of data type FP16");
+    default:
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (std::string("unable to fill tensors of data type ") +
+           TRITONSERVER_DataTypeString(datatype))
+              .c_str());
+  }
+
+  return nullptr;  // success
+}
+
+void
+SetStagingBufferHugePageMode(const HugePageMode mode)
+{
+  staging_buffer_huge_page_mode = static_cast<int>(mode);
+}
+
+char*
+StagingBufferAlloc(const size_t byte_size)
+{
+  const HugePageMode mode =
+      static_cast<HugePageMode>(staging_buffer_huge_page_mode.load());
+  const size_t total_byte_size = byte_size + kStagingBufferHeaderSize;
+
+  StagingBufferHeader header{total_byte_size, 0, false};
+  void* base = nullptr;
+  // Buffers smaller than a huge page gain nothing from huge pages.
+  if ((mode != HugePageMode::NONE) && (total_byte_size >= kHugePageSize)) {
+    const size_t rounded_byte_size =
+        ((total_byte_size + kHugePageSize - 1) / kHugePageSize) *
+        kHugePageSize;
+    if (mode == HugePageMode::EXPLICIT) {
+      base = mmap(
+          nullptr, rounded_byte_size, PROT_READ | PROT_WRITE,
+          MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+      if (base == MAP_FAILED) {
+        // The huge page pool is exhausted or not configured, fall back
+        // to transparent huge pages.
+        base = nullptr;
+      } else {
+        header = {rounded_byte_size, rounded_byte_size, true};
+      }
+    }
+    if ((base == nullptr) &&
+        (posix_memalign(&base, kHugePageSize, rounded_byte_size) == 0)) {
+      header = {rounded_byte_size, 0, false};
+      if (madvise(base, rounded_byte_size, MADV_HUGEPAGE) == 0) {
+        header.huge_page_byte_size_ = rounded_byte_size;
+      }
+    }
+  }
+  if (base == nullptr) {
+    base = malloc(total_byte_size);
+    if (base == nullptr) {
+      return nullptr;
+    }
+  }
+
+  if (header.huge_page_byte_size_ > 0) {
+    const size_t bytes =
+        staging_buffer_huge_page_bytes += header.huge_page_byte_size_;
+    size_t peak_bytes = staging_buffer_huge_page_peak_bytes.load();
+    while ((bytes > peak_bytes) &&
+           !staging_buffer_huge_page_peak_bytes.compare_exchange_weak(
+               peak_bytes, bytes)) {
+    }
+  }
+  *reinterpret_cast<StagingBufferHeader*>(base) = header;
+  return reinterpret_cast<char*>(base) + kStagingBufferHeaderSize;
+}
+
+void
+StagingBufferFree(char* buffer)
+{
+  if (buffer == nullptr) {
+    return;
+  }
+
+  char* base = buffer - kStagingBufferHeaderSize;
+  const StagingBufferHeader header =
+      *reinterpret_cast<StagingBufferHeader*>(base);
+  staging_buffer_huge_page_bytes -= header.huge_page_byte_size_;
+  if (header.mmapped_) {
+    munmap(base, header.allocated_byte_size_);
+  } else {
+    free(base);
+  }
+}
+
+size_t
+StagingBufferHugePageByteSize()
+{
+  return staging_buffer_huge_page_bytes;
+}
+
+size_t
+StagingBufferHugePagePeakByteSize()
+{
+  return staging_buffer_huge_page_peak_bytes;
+}
+
+ScratchArena::~ScratchArena()
+{
+  for (auto& block : blocks_) {
+    StagingBufferFree(block.base_);
+  }
+}
+
+char*
+ScratchArena::Allocate(const size_t byte_size)
+{
+  // Keep the buffers cache-line aligned.
+  constexpr size_t kAlignment = 64;
+  constexpr size_t kMinBlockByteSize = 64 * 1024;
+  const size_t aligned_byte_size =
+      (byte_size + kAlignment - 1) & ~(kAlignment - 1);
+
+  while (current_block_ < blocks_.size()) {
+    Block& block = blocks_[current_block_];
+    if ((block.byte_size_ - current_offset_) >= aligned_byte_size) {
+      char* buffer = block.base_ + current_offset_;
+      current_offset_ += aligned_byte_size;
+      return buffer;
+    }
+    ++current_block_;
+    current_offset_ = 0;
+  }
+
+  // Grow geometrically so an execution needs a few blocks at most.
+  const size_t last_byte_size =
+      blocks_.empty() ? 0 : blocks_.back().byte_size_;
+  const size_t block_byte_size = std::max(
+      aligned_byte_size, std::max(kMinBlockByteSize, 2 * last_byte_size));
+  char* base = StagingBufferAlloc(block_byte_size);
+  if (base == nullptr) {
+    return nullptr;
+  }
+  blocks_.push_back({base, block_byte_size});
+  current_block_ = blocks_.size() - 1;
+  current_offset_ = aligned_byte_size;
+  return base;
+}
+
+void
+ScratchArena::Reset()
+{
+  if (blocks_.size() > 1) {
+    size_t total_byte_size = 0;
+    for (auto& block : blocks_) {
+      total_byte_size += block.byte_size_;
+      StagingBufferFree(block.base_);
+    }
+    blocks_.clear();
+    char* base = StagingBufferAlloc(total_byte_size);
+    if (base != nullptr) {
+      blocks_.push_back({base, total_byte_size});
+    }
+  }
+  current_block_ = 0;
+  current_offset_ = 0;
+}
+
+bool
+ShapeSignatureCache::Lookup(const std::string& signature)
+{
+  auto it = index_.find(signature);
+  if (it != index_.end()) {
+    lru_.splice(lru_.begin(), lru_, it->second);
+    ++hits_;
+    return true;
+  }
+
+  ++misses_;
+  if (capacity_ == 0) {
+    return false;
+  }
+  if (lru_.size() >= capacity_) {
+    index_.erase(lru_.back());
+    lru_.pop_back();
+  }
+  lru_.push_front(signature);
+  index_[signature] = lru_.begin();
+  return false;
+}
+
 TRITONSERVER_Error*
 ParseParameter(
     triton::common::TritonJson::Value& params, const std::string& mkey,
@@ -25,6 +25,9 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #pragma once
 
+#include <list>
+#include <unordered_map>
+
 #include "tensorflow_backend_tf.h"
 #include "triton/backend/backend_common.h"
 #include "triton/core/tritonserver.h"
@@ -87,6 +90,147 @@ TRITONTF_DataType ConvertDataType(const std::string& dtype);
 /// configuration data-type.
 TRITONTF_DataType ConvertDataType(TRITONSERVER_DataType dtype);
 
+/// \return the substrings of 'str' separated by 'delim'. Empty
+/// substrings are preserved.
+std::vector<std::string> SplitString(const std::string& str, const char delim);
+
+/// Parse a CPU list such as "0-3,8,10-11" into the list of CPU IDs.
+/// \return nullptr if the list is parsed successfully, an error if it
+/// is malformed or names a CPU that the host doesn't have or that
+/// can't be pinned to.
+TRITONSERVER_Error* ParseCpuList(
+    const std::string& str, std::vector<int>* cpus);
+
+/// Get in 'cpus' the CPUs of NUMA node 'numa_node'.
+/// \return nullptr if the CPUs of the node are found.
+TRITONSERVER_Error* NumaNodeCpus(const int numa_node, std::vector<int>* cpus);
+
+/// Hash the model file, or all the files under the model directory, at
+/// 'path'. 'canonical_path' returns the absolute path with symbolic
+/// links resolved and 'hash' a hash of the relative paths and the
+/// contents of the files.
+/// \return nullptr if the files are hashed successfully.
+TRITONSERVER_Error* HashModelFiles(
+    const std::string& path, std::string* canonical_path, uint64_t* hash);
+
+/// Parse 'buffer' in the BYTES wire format, where each element is a
+/// 4-byte length followed by that many bytes. The start and length of
+/// each element are written to 'strs' and 'lengths', which must have
+/// room for 'expected_element_cnt' elements. 'parsed_element_cnt'
+/// returns the number of elements parsed, including when an error is
+/// returned. The errors are the same as those of
+/// triton::backend::ValidateStringBuffer, but 'buffer' isn't modified.
+TRITONSERVER_Error* ParseStringBuffer(
+    const char* buffer, const size_t buffer_byte_size,
+    const size_t expected_element_cnt, const char* input_name,
+    const char** strs, size_t* lengths, size_t* parsed_element_cnt);
+
+/// Copy the leading block of shape 'block_dims' of the row-major
+/// tensor 'src' of shape 'src_dims' to the same position of the
+/// row-major tensor 'dst' of shape 'dst_dims'. The shapes must have
+/// the same rank and 'block_dims' must fit in both 'src_dims' and
+/// 'dst_dims', so a tensor is padded by copying it into a larger one
+/// and cropped by copying a block of it into a smaller one.
+void CopyTensorBlock(
+    const char* src, const std::vector<int64_t>& src_dims, char* dst,
+    const std::vector<int64_t>& dst_dims,
+    const std::vector<int64_t>& block_dims, const size_t element_byte_size);
+
+/// Repeat the first row of 'row_byte_size' bytes of 'buffer' until
+/// 'buffer' holds 'row_count' rows. The filled part is copied onto
+/// the rest, doubling it each time, so the number of copies grows
+/// with the logarithm of 'row_count'.
+void TileRows(char* buffer, const size_t row_byte_size, const size_t row_count);
+
+/// Fill 'element_cnt' elements of 'datatype' at 'dst' with 'value'.
+/// \return nullptr if the elements are filled, an error if 'datatype'
+/// can't be filled with 'value'.
+TRITONSERVER_Error* FillTensorValue(
+    char* dst, const size_t element_cnt, const TRITONSERVER_DataType datatype,
+    const double value);
+
+/// How the backend CPU staging buffers are backed by huge pages.
+enum class HugePageMode { NONE, TRANSPARENT, EXPLICIT };
+
+/// Set how the CPU staging buffers allocated after this call are
+/// backed by huge pages.
+void SetStagingBufferHugePageMode(const HugePageMode mode);
+
+/// \return a CPU staging buffer of 'byte_size' bytes. Large buffers
+/// are backed by huge pages if enabled by
+/// SetStagingBufferHugePageMode. The buffer must be released with
+/// StagingBufferFree.
+char* StagingBufferAlloc(const size_t byte_size);
+
+/// Release a buffer returned by StagingBufferAlloc. 'buffer' may be
+/// nullptr.
+void StagingBufferFree(char* buffer);
+
+/// \return the number of bytes of the live staging buffers that are
+/// mapped from the huge page pool or advised to use transparent huge
+/// pages.
+size_t StagingBufferHugePageByteSize();
+
+/// \return the largest value StagingBufferHugePageByteSize has had.
+size_t StagingBufferHugePagePeakByteSize();
+
+/// A bump allocator for the temporary CPU buffers of one execution.
+/// Buffers are carved out of blocks that are kept across Reset(), so
+/// once the arena has grown to the size an execution needs, no more
+/// memory is allocated. Blocks come from StagingBufferAlloc.
+class ScratchArena {
+ public:
+  ScratchArena() = default;
+  ~ScratchArena();
+  ScratchArena(const ScratchArena&) = delete;
+  ScratchArena& operator=(const ScratchArena&) = delete;
+
+  /// \return a buffer of 'byte_size' bytes that stays valid until the
+  /// next Reset(), or nullptr if the memory can't be allocated.
+  char* Allocate(const size_t byte_size);
+
+  /// Release all buffers at once. If the last execution needed more
+  /// than one block, the blocks are replaced by a single block large
+  /// enough for all of them.
+  void Reset();
+
+ private:
+  struct Block {
+    char* base_;
+    size_t byte_size_;
+  };
+
+  std::vector<Block> blocks_;
+  // The block that buffers are allocated from and the used bytes of
+  // that block.
+  size_t current_block_ = 0;
+  size_t current_offset_ = 0;
+};
+
+/// The most recently used input shape signatures of the runs of a
+/// model instance, kept up to 'capacity' signatures. A run whose
+/// signature is not in the set has a new combination of input shapes,
+/// for which oneDNN creates new primitives.
+class ShapeSignatureCache {
+ public:
+  explicit ShapeSignatureCache(const size_t capacity) : capacity_(capacity) {}
+
+  /// Record a run with 'signature'. \return true if the signature was
+  /// already in the set.
+  bool Lookup(const std::string& signature);
+
+  uint64_t Hits() const { return hits_; }
+  uint64_t Misses() const { return misses_; }
+
+ private:
+  size_t capacity_;
+  // Most recently used signature first.
+  std::list<std::string> lru_;
+  std::unordered_map<std::string, std::list<std::string>::iterator> index_;
+  uint64_t hits_ = 0;
+  uint64_t misses_ = 0;
+};
+
 TRITONSERVER_Error* ParseParameter(
     triton::common::TritonJson::Value& params, const std::string& mkey,
     bool* value);